@@ -5,38 +5,74 @@
 
 #include <og3/ha_discovery.h>
 #include <og3/satellite.pb.h>
+#include <og3/sensor-aggregator.h>
+#include <og3/sensor-history.h>
+#include <og3/string-pool.h>
 #include <og3/variable.h>
 
+#include <cstring>
 #include <map>
 #include <memory>
 #include <string>
+#include <vector>
 
 namespace og3::base_station {
 
 class Device;
+class DormantDevice;
+
+using DeviceMap = std::map<uint32_t, std::unique_ptr<Device>>;
+using DormantDeviceMap = std::map<uint32_t, std::unique_ptr<DormantDevice>>;
 
 class Sensor {
  public:
   Sensor(const char* name, const char* device_class, const char* units, Device* device,
          og3_Sensor_StateClass state_class);
 
-  const std::string& name() const { return m_name; }
-  const char* cname() const { return name().c_str(); }
-  const std::string& device_class() const { return m_device_class; }
-  const char* cdevice_class() const { return device_class().c_str(); }
-  const std::string& units() const { return m_units; }
-  const char* cunits() const { return units().c_str(); }
+  // Names are stored in the device's arena; classes and units are interned in StringPool.
+  const char* name() const { return m_name; }
+  const char* cname() const { return m_name; }
+  const char* device_class() const { return m_device_class; }
+  const char* cdevice_class() const { return m_device_class; }
+  const char* units() const { return m_units; }
+  const char* cunits() const { return m_units; }
   og3_Sensor_StateClass state_class() const { return m_state_class; }
 
+  // Readings passed to set_value() are aggregated before updating value().  By default,
+  // MEASUREMENT sensors publish the mean of SensorAggregator::kDefaultWindowSecs windows, and
+  // other sensors publish every reading.
+  const SensorAggregator& aggregator() const { return m_aggregator; }
+  void set_aggregation(const SensorAggregator::Config& config) { m_aggregator.set_config(config); }
+  static SensorAggregator::Config default_aggregation(og3_Sensor_StateClass state_class);
+
+  // The history is only kept after enable_history() is called on the sensor.
+  SensorHistory* history() { return m_history.get(); }
+  const SensorHistory* history() const { return m_history.get(); }
+  // Summarize history in [start_secs, end_secs) as {"t":[..], "min":[..], "max":[..], "avg":[..]}
+  // arrays with one element per non-empty bucket, for rendering by the bridge web UI.
+  bool write_history_json(JsonObject obj, uint32_t start_secs, uint32_t end_secs,
+                          size_t num_buckets) const;
+
+  // The clock used to timestamp history, in seconds.  By default this is millis() / 1000, which
+  // restarts at each boot, so histories are not saved to flash.  Apps with wall-clock time (e.g.,
+  // from NTP) can install their own clock to keep history across reboots.
+  using ClockFn = uint32_t (*)();
+  static void set_clock(ClockFn clock_fn);
+  static uint32_t now_secs();
+  // True if a clock other than the default has been installed with set_clock().
+  static bool has_wall_clock();
+
  protected:
   void addHAEntry(HADiscovery::Entry& entry);
 
-  const std::string m_name;
-  const std::string m_device_class;
-  const std::string m_units;
-  const std::string m_description;
+  const char* const m_name;
+  const char* const m_device_class;
+  const char* const m_units;
+  const char* const m_description;
   const og3_Sensor_StateClass m_state_class;
   Device* m_device;
+  SensorAggregator m_aggregator;
+  std::unique_ptr<SensorHistory> m_history;
 };
 
 class FloatSensor : public Sensor {
@@ -47,7 +83,14 @@ class FloatSensor : public Sensor {
 
   FloatVariable& value() { return m_value; }
   const FloatVariable& value() const { return m_value; }
-  void set_failed() { m_value.setFailed(); }
+  // Set the value from a received reading, recording it in the history if enabled.
+  // Returns true if value() was updated and should be published.
+  bool set_value(float value);
+  // Returns true if a window of aggregated readings was closed and value() should be published.
+  bool flush_aggregation();
+  void set_failed();
+
+  SensorHistory* enable_history(size_t capacity = SensorHistory::kDefaultCapacity);
 
  private:
   FloatVariable m_value;
@@ -60,7 +103,14 @@ class IntSensor : public Sensor {
 
   Variable<int>& value() { return m_value; }
   const Variable<int>& value() const { return m_value; }
-  void set_failed() { m_value.setFailed(); }
+  // Set the value from a received reading, recording it in the history if enabled.
+  // Returns true if value() was updated and should be published.
+  bool set_value(int value);
+  // Returns true if a window of aggregated readings was closed and value() should be published.
+  bool flush_aggregation();
+  void set_failed();
+
+  SensorHistory* enable_history(size_t capacity = SensorHistory::kDefaultCapacity);
 
  private:
   Variable<int> m_value;
@@ -72,17 +122,27 @@ class Device {
          ModuleSystem* module_system, HADiscovery* ha_discovery, uint16_t seq_id,
          VariableGroup& cvg);
 
-  const std::string& name() const { return m_name; }
-  const char* cname() const { return name().c_str(); }
-  void set_name(const char* name) { m_name = name; }
-  const std::string& device_id() const { return m_device_id; }
-  const char* cdevice_id() const { return device_id().c_str(); }
-  const std::string& manufacturer() const { return m_manufacturer; }
+  // Strings specific to this device are stored in its arena, and shared ones are interned in
+  // StringPool.  Either way, they stay valid for the life of the device.
+  const char* name() const { return m_name; }
+  const char* cname() const { return m_name; }
+  void set_name(const char* name) {
+    // Description packets repeat the name, so only copy it into the arena when it changes.
+    if (name && strcmp(name, m_name) != 0) {
+      m_name = m_arena.add(name);
+    }
+  }
+  const char* device_id() const { return m_device_id; }
+  const char* cdevice_id() const { return m_device_id; }
+  const char* manufacturer() const { return m_manufacturer; }
   uint32_t mfg_id() const { return m_mfg_id; }
   void set_mfg_id(uint32_t mfg_id);
-  const std::string& device_type() const { return m_device_type; }
-  const char* cdevice_type() const { return device_type().c_str(); }
-  void set_device_type(const char* device_type) { m_device_type = device_type; }
+  const char* device_type() const { return m_device_type; }
+  const char* cdevice_type() const { return m_device_type; }
+  void set_device_type(const char* device_type) {
+    m_device_type = StringPool::intern(device_type);
+  }
+  StringArena& arena() { return m_arena; }
 
   const og3_Version& hardware_version() const { return m_hw_version; }
   void set_hardware_version(const og3_Version& v) { m_hw_version = v; }
@@ -108,15 +168,74 @@ class Device {
   bool isTimedOut() const;
   void set_comms_timeout_millis(uint32_t ms) { m_comms_timeout_millis = ms; }
 
+  // Reporting configuration for the satellite, sent in a Downlink until it is acknowledged.
+  struct DownlinkConfig {
+    uint32_t id = 0;  // 0 means nothing has been configured.
+    uint32_t report_interval_secs = 0;
+    uint32_t batch_size = 0;
+    bool resend_desc = false;
+    uint32_t acked_id = 0;  // config_ack last reported by the satellite
+
+    // True if the satellite's last reported config_ack differs from the current configuration.
+    bool is_pending() const { return id != 0 && id != acked_id; }
+    // Give the configuration a new id, which the satellite can't have acknowledged already.
+    void changed();
+    bool make_downlink(uint32_t device_id, og3_Downlink& downlink) const;
+    // Record the config_ack reported by the satellite.  Returns true if it acknowledges a
+    // configuration which has been set.
+    bool got_ack(uint32_t config_id);
+  };
+  const DownlinkConfig& downlink_config() const { return m_downlink_config; }
+  void set_report_interval_secs(uint32_t secs);
+  void set_batch_size(uint32_t batch_size);
+  void request_desc_resend();
+  bool is_downlink_pending() const { return m_downlink_config.is_pending(); }
+  // Fill `downlink` to send in the satellite's receive window.  Returns false if there is
+  // nothing to send.
+  bool make_downlink(og3_Downlink& downlink) const;
+  // Handle the config_ack field of every packet from the satellite.
+  void got_downlink_ack(uint32_t config_id);
+
   /** @brief Persistence: Save all devices in the map to a JSON file. */
   static bool saveAll(const char* filename, ConfigInterface* config,
                       const std::map<uint32_t, std::unique_ptr<Device>>& devices);
+  /** @brief Persistence: Save live and dormant devices to a JSON file.  A device in both maps
+   * is saved once, from `devices`. */
+  static bool saveAll(const char* filename, ConfigInterface* config, const DeviceMap& devices,
+                      const DormantDeviceMap& dormant);
 
   /** @brief Persistence: Load devices from a JSON file. */
   using CreateDeviceFn = std::function<Device*(
       uint32_t id, const char* name, uint32_t mfg_id, const char* type, uint32_t timeout_ms,
       const og3_Version& hw_version, const og3_Version& sw_version)>;
   static bool loadAll(const char* filename, ConfigInterface* config, CreateDeviceFn create_fn);
+  /** @brief Persistence: Load devices from a JSON file as dormant records. */
+  static bool loadDormant(const char* filename, ConfigInterface* config,
+                          DormantDeviceMap* dormant);
+
+  // Upgrade dormant device `id` to a live Device made by `create_fn`, e.g. when it sends a
+  // packet.  History and aggregation settings are not remembered, so `create_fn` should apply
+  // them.  Returns nullptr if `id` is not a dormant device.
+  static Device* wake(uint32_t id, DormantDeviceMap* dormant, CreateDeviceFn create_fn);
+  // Demote devices which have not sent a packet for `idle_millis` to dormant records, so that
+  // RAM use scales with active devices.  Demoted devices are destroyed, so the app must not
+  // hold pointers to them.  Their sensor histories and pending aggregation windows are dropped,
+  // so apps which keep history should call saveHistory() first, and loadHistory() after wake().
+  // Returns the number of devices demoted.
+  static unsigned demoteIdle(uint32_t idle_millis, DeviceMap* devices, DormantDeviceMap* dormant);
+
+  // Keep a history of readings for each sensor of this device, including sensors added later.
+  void enable_history(size_t capacity = SensorHistory::kDefaultCapacity);
+  // Apply an aggregation config to every sensor of this device, including sensors added later.
+  void set_aggregation(const SensorAggregator::Config& config);
+  // Close elapsed aggregation windows of all sensors.  This should be called periodically, and
+  // returns true if any sensor value was updated, so the device's variables should be published.
+  bool flush_aggregation();
+  /** @brief Persistence: Spill sensor histories of this device to flash, one JSON file per
+   * sensor named `<prefix>_f<id>` or `<prefix>_i<id>`.  This requires Sensor::has_wall_clock(). */
+  bool saveHistory(const char* prefix, ConfigInterface* config) const;
+  /** @brief Persistence: Restore sensor histories of this device saved by saveHistory(). */
+  bool loadHistory(const char* prefix, ConfigInterface* config);
 
   FloatSensor* float_sensor(unsigned id) {
     auto iter = m_id_to_float_sensor.find(id);
@@ -125,22 +244,14 @@ class Device {
   FloatSensor* add_float_sensor(
       unsigned id, const char* name, const char* device_class, const char* units, unsigned decimals,
       Device* device,
-      og3_Sensor_StateClass state_class = og3_Sensor_StateClass_STATE_CLASS_UNSPECIFIED) {
-    auto iter = m_id_to_float_sensor.emplace(
-        id, new FloatSensor(name, device_class, units, decimals, this, state_class));
-    return iter.first->second.get();
-  }
+      og3_Sensor_StateClass state_class = og3_Sensor_StateClass_STATE_CLASS_UNSPECIFIED);
   IntSensor* int_sensor(unsigned id) {
     auto iter = m_id_to_int_sensor.find(id);
     return (iter == m_id_to_int_sensor.end()) ? nullptr : iter->second.get();
   }
   IntSensor* add_int_sensor(
       unsigned id, const char* name, const char* device_class, const char* units, Device* device,
-      og3_Sensor_StateClass state_class = og3_Sensor_StateClass_STATE_CLASS_UNSPECIFIED) {
-    auto iter =
-        m_id_to_int_sensor.emplace(id, new IntSensor(name, device_class, units, this, state_class));
-    return iter.first->second.get();
-  }
+      og3_Sensor_StateClass state_class = og3_Sensor_StateClass_STATE_CLASS_UNSPECIFIED);
   // Updates m_dropped_packets.
   void got_packet(uint16_t seq_id, int rssi);
 
@@ -155,12 +266,15 @@ class Device {
   }
 
  private:
+  friend class DormantDevice;
+
   const uint32_t m_device_id_num;
-  std::string m_name;
-  const std::string m_device_id;
+  StringArena m_arena;
+  const char* m_name;
+  const char* const m_device_id;
   uint32_t m_mfg_id;
-  std::string m_manufacturer;
-  std::string m_device_type;
+  const char* m_manufacturer;
+  const char* m_device_type;
   og3_Version m_hw_version;
   og3_Version m_sw_version;
   uint16_t m_seq_id;
@@ -171,12 +285,55 @@ class Device {
   unsigned m_packet_count = 0;
   std::map<unsigned, std::unique_ptr<FloatSensor>> m_id_to_float_sensor;
   std::map<unsigned, std::unique_ptr<IntSensor>> m_id_to_int_sensor;
-  std::string m_str_disabled;
-  BoolVariable m_disabled;
+  BoolVariable& m_disabled;
   uint32_t m_last_packet_millis = 0;
   bool m_is_online = false;
-  // TODO(chl33): How can this be configured??
+  // Set by the app (e.g., from the satellite's timeout_secs), and extended when a satellite
+  // acknowledges a slower report interval.
   uint32_t m_comms_timeout_millis = 15 * 60 * 1000;  // 15 minutes.
+  DownlinkConfig m_downlink_config;
+  size_t m_history_capacity = 0;  // 0 if enable_history() has not been called
+  // Set by set_aggregation(), otherwise sensors use Sensor::default_aggregation().
+  std::unique_ptr<SensorAggregator::Config> m_aggregation;
+};
+
+// The persisted metadata of a device, without its variables, HA discovery entries or MQTT
+// availability.  Devices which are remembered but have not sent a packet recently are kept
+// in this form, and woken into a live Device when they send one.
+class DormantDevice {
+ public:
+  struct SensorDesc {
+    unsigned id;
+    bool is_float;
+    unsigned decimals;
+    og3_Sensor_StateClass state_class;
+    const char* name;
+    const char* device_class;
+    const char* units;
+  };
+
+  explicit DormantDevice(const Device& device);
+  explicit DormantDevice(JsonObjectConst obj);
+
+  uint32_t id_num() const { return m_device_id_num; }
+  const char* name() const { return m_name; }
+  const std::vector<SensorDesc>& sensors() const { return m_sensors; }
+
+  void write_json(JsonObject obj) const;
+  // Create a live device with `create_fn`, and add the remembered sensors and configuration.
+  Device* wake(Device::CreateDeviceFn create_fn) const;
+
+ private:
+  StringArena m_arena{64};
+  uint32_t m_device_id_num;
+  const char* m_name;
+  uint32_t m_mfg_id;
+  const char* m_device_type;
+  uint32_t m_comms_timeout_millis;
+  og3_Version m_hw_version;
+  og3_Version m_sw_version;
+  Device::DownlinkConfig m_downlink_config;
+  std::vector<SensorDesc> m_sensors;
 };
 
 }  // namespace og3::base_station
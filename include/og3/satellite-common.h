@@ -0,0 +1,22 @@
+// Copyright (c) 2026 Chris Lee and contributors.
+// Licensed under the MIT license. See LICENSE file in the project root for details.
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+
+// Definitions shared by satellites and the base station.
+namespace og3 {
+
+// The base station times out a satellite after this many missed reports.
+constexpr uint32_t kTimeoutReportIntervals = 3;
+
+// The comms timeout for a satellite reporting every `report_interval_secs`, saturating rather
+// than overflowing for very long intervals.
+inline uint32_t report_timeout_secs(uint32_t report_interval_secs) {
+  return static_cast<uint32_t>(
+      std::min<uint64_t>(uint64_t{kTimeoutReportIntervals} * report_interval_secs, UINT32_MAX));
+}
+
+}  // namespace og3
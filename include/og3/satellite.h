@@ -2,9 +2,12 @@
 // Licensed under the MIT license. See LICENSE file in the project root for details.
 
 #include <og3/adc_voltage.h>
+#include <og3/config_interface.h>
+#include <og3/satellite-common.h>
 #include <og3/units.h>
 #include <og3/variable.h>
 
+#include <functional>
 #include <memory>
 #include <vector>
 
@@ -16,8 +19,13 @@ class PacketReading {
  public:
   PacketReading(unsigned sensor_id, og3_Sensor_Type sensor_type, og3_Sensor_StateClass state_class)
       : m_sensor_id(sensor_id), m_sensor_type(sensor_type), m_state_class(state_class) {}
+  virtual ~PacketReading() = default;
 
   virtual bool read() = 0;
+  // Non-blocking acquisition: start_read() begins a reading, then poll_read() is called
+  // periodically until it returns true.  By default, this simply calls read().
+  virtual void start_read() { read(); }
+  virtual bool poll_read() { return true; }
   virtual bool write(og3_Packet& packet) = 0;
   virtual bool write_desc(og3_Packet& packet) = 0;
 
@@ -37,26 +45,55 @@ class PacketFloatReading : public PacketReading {
   bool write(og3_Packet& packet) override;
   bool write_desc(og3_Packet& packet) override;
 
- private:
+ protected:
+  // The value to send in a packet.
+  virtual float value() const { return m_var.value(); }
+
   const FloatVariable& m_var;
 };
 
+// Collects several samples of a reading and averages them, discarding outliers.
+class Oversampler {
+ public:
+  static constexpr unsigned kMaxSamples = 16;
+
+  explicit Oversampler(unsigned num_samples = 1);
+
+  void reset() { m_count = 0; }
+  void add(float sample);
+  unsigned count() const { return m_count; }
+  unsigned num_samples() const { return m_num_samples; }
+  bool is_done() const { return m_count >= m_num_samples; }
+  // The mean of the samples, excluding the lowest and highest quarter of them.
+  float value() const;
+
+ private:
+  const unsigned m_num_samples;
+  unsigned m_count = 0;
+  float m_samples[kMaxSamples];
+};
+
+// Reads an ADC voltage, optionally averaging `num_samples` samples taken back-to-back.
+// The averaged value is what is sent in packets; adc.valueVariable() keeps the last raw sample.
 class PacketVoltageReading : public PacketFloatReading {
  public:
   PacketVoltageReading(
       unsigned sensor_id, AdcVoltage& adc,
-      og3_Sensor_StateClass state_class = og3_Sensor_StateClass_STATE_CLASS_UNSPECIFIED)
+      og3_Sensor_StateClass state_class = og3_Sensor_StateClass_STATE_CLASS_UNSPECIFIED,
+      unsigned num_samples = 1)
       : PacketFloatReading(sensor_id, og3_Sensor_Type_TYPE_VOLTAGE, adc.valueVariable(),
                            state_class),
-        m_adc(adc) {}
+        m_adc(adc),
+        m_sampler(num_samples) {}
 
-  bool read() final {
-    m_adc.read();
-    return true;
-  }
+  bool read() final;
+
+ protected:
+  float value() const final;
 
  private:
   AdcVoltage& m_adc;
+  Oversampler m_sampler;
 };
 
 class PacketIntReading : public PacketReading {
@@ -84,25 +121,65 @@ class PacketSender {
     uint16_t seq_id;
     unsigned secs_device_sent;
     unsigned sensor_descriptions_sent;
+    // Configuration received from the base station in a Downlink.
+    uint32_t config_id;
+    uint32_t report_interval_secs;
+    uint32_t batch_size;
   };
 
   void send_desc(size_t max_size);
+  // Read all sensors, blocking until done, then send them in a packet.
   void send_all_readings();
-  bool is_sending() const { return m_is_sending; }
+  // Call start_radio(), then start acquiring all readings without blocking, so slow conversions
+  // overlap with radio warm-up.  Readings are polled until all are done, the packet is sent, and
+  // then `on_sent` is called.
+  void acquire_and_send_readings(std::function<void()> on_sent = nullptr);
+  bool is_acquiring() const { return m_is_acquiring; }
+
+  // Decode and apply a Downlink received after sending a packet.  Returns true if it was
+  // addressed to this device.  It is acknowledged in the next packet sent.  Apps which want
+  // the configuration to survive power loss should then call save_config().
+  bool handle_downlink(const uint8_t* buf, size_t len);
+  bool apply_downlink(const og3_Downlink& downlink);
+  // Configured reporting interval, or `default_secs` if the base station has not set one.
+  uint32_t report_interval_secs(uint32_t default_secs) const {
+    return m_rtc->report_interval_secs ? m_rtc->report_interval_secs : default_secs;
+  }
+  // Configured number of readings to batch per transmission, or 1 if not set.
+  uint32_t batch_size() const { return m_rtc->batch_size ? m_rtc->batch_size : 1; }
+
+  /** @brief Persistence: Save the downlink configuration so it survives power loss. */
+  bool save_config(const char* filename, ConfigInterface* config) const;
+  /** @brief Persistence: Load the downlink configuration into RTC memory. */
+  bool load_config(const char* filename, ConfigInterface* config);
+  bool is_sending() const { return m_is_sending || m_is_acquiring; }
   void set_is_sending(bool is_sending) { m_is_sending = is_sending; }
   void set_board_id(uint32_t board_id) { m_board_id = board_id; }
 
  protected:
+  // `app` may be null in tests of acquisition and downlinks.  Then nothing is logged, and
+  // poll_readings() must be called until is_acquiring() is false.
   PacketSender(const og3_Device* device, App* app, Rtc* rtc)
       : m_device(device), m_app(app), m_rtc(rtc) {}
   void start_packet(og3_Packet& packet, bool update_device);
   virtual void send_packet(og3_Packet& packet) = 0;
+  // Called by acquire_and_send_readings() before readings are started.
+  virtual void start_radio() {}
+  void send_readings_packet();
+  // Poll readings which are not done, and send the packet once they all are.
+  void poll_readings();
+
+  // How often to poll readings which are being acquired.
+  static constexpr unsigned kPollMsec = 2;
 
   const og3_Device* m_device;
   App* m_app;
   Rtc* m_rtc;
   std::vector<std::unique_ptr<PacketReading>> m_readings;
   bool m_is_sending = false;
+  bool m_is_acquiring = false;
+  std::vector<bool> m_read_done;
+  std::function<void()> m_on_sent;
   uint32_t m_board_id = 0xFFFF;
 };
 
@@ -0,0 +1,79 @@
+// Copyright (c) 2026 Chris Lee and contributors.
+// Licensed under the MIT license. See LICENSE file in the project root for details.
+
+#pragma once
+
+#include <cstdint>
+
+namespace og3::base_station {
+
+// Aggregates readings of one sensor into tumbling windows so that a chatty satellite publishes
+// at most one value per window, optionally suppressing changes smaller than a deadband.
+//
+// A window starts when a value is published.  Readings are accumulated until one arrives after
+// the window has elapsed, or until flush() is called after it has elapsed, and then the
+// window's statistic is published.  A reading arriving after a quiet period is therefore
+// published immediately.
+class SensorAggregator {
+ public:
+  enum class Output { kMean, kLast, kMin, kMax };
+
+  struct Config {
+    // Length of a window.  0 means every reading is published (subject to the deadband).
+    uint32_t window_secs = 0;
+    // Changes in the published value smaller than this are not published.
+    float deadband = 0.0f;
+    // When using a deadband, publish at least this often anyway.  0 means no limit.
+    uint32_t max_quiet_secs = 0;
+    // Which statistic of the window to publish.
+    Output output = Output::kMean;
+  };
+
+  struct Window {
+    float min = 0.0f;
+    float max = 0.0f;
+    float mean = 0.0f;
+    float last = 0.0f;
+    unsigned count = 0;
+  };
+
+  // Used for sensors with STATE_CLASS_MEASUREMENT unless configured otherwise.
+  static constexpr uint32_t kDefaultWindowSecs = 60;
+
+  SensorAggregator() {}
+  explicit SensorAggregator(const Config& config) : m_config(config) {}
+
+  const Config& config() const { return m_config; }
+  void set_config(const Config& config);
+
+  // Add a reading taken at `secs`.  Returns true and sets *out if a value should be published.
+  bool add(uint32_t secs, float value, float* out);
+  // Close the current window if it has elapsed.  Returns true and sets *out if a value should
+  // be published.
+  bool flush(uint32_t secs, float* out);
+  // Forget the current window and the last published value, e.g. after the sensor failed.
+  void reset();
+
+  // Statistics of the most recently closed window.
+  const Window& last_window() const { return m_last_window; }
+  bool has_pending() const { return m_count > 0; }
+
+ private:
+  bool close(uint32_t secs, float* out);
+
+  Config m_config;
+  Window m_last_window;
+  // Accumulators for the current window.
+  unsigned m_count = 0;
+  float m_min = 0.0f;
+  float m_max = 0.0f;
+  float m_last = 0.0f;
+  double m_sum = 0.0;
+  uint32_t m_window_start_secs = 0;
+  // Last published value.
+  bool m_has_published = false;
+  float m_published = 0.0f;
+  uint32_t m_published_secs = 0;
+};
+
+}  // namespace og3::base_station
@@ -0,0 +1,106 @@
+// Copyright (c) 2026 Chris Lee and contributors.
+// Licensed under the MIT license. See LICENSE file in the project root for details.
+
+#pragma once
+
+#include <ArduinoJson.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace og3::base_station {
+
+// A bounded history of readings for one sensor, kept on the base station so the bridge can
+// render charts without a round-trip through Home Assistant.
+//
+// Values are quantized to fixed-point using the sensor's number of decimals, and each sample is
+// stored as a (seconds, value) delta from the previous sample, so a sample costs 4 bytes.
+// When the ring is full, the oldest sample is dropped.  Deltas which do not fit are saturated
+// against the reconstructed previous value, so an error on one sample does not accumulate.
+// Silences longer than a delta can hold are covered by gap entries.
+class SensorHistory {
+ public:
+  // 512 samples * 4 bytes = 2 KB per sensor.
+  static constexpr size_t kDefaultCapacity = 512;
+
+  struct Bucket {
+    uint32_t start_secs = 0;
+    float min = 0.0f;
+    float max = 0.0f;
+    float avg = 0.0f;
+    unsigned count = 0;
+  };
+
+  // `capacity` is the number of samples kept, at least 2.
+  SensorHistory(unsigned decimals, size_t capacity = kDefaultCapacity);
+
+  // Record a reading taken at time `secs`.  Non-finite readings are recorded as gaps.
+  void add(uint32_t secs, float value);
+  // Record that there was no valid reading at time `secs` (e.g., the sensor failed).
+  void add_gap(uint32_t secs);
+
+  size_t size() const { return m_size; }
+  size_t capacity() const { return m_entries.size(); }
+  bool empty() const { return m_size == 0; }
+  unsigned decimals() const { return m_decimals; }
+  uint32_t oldest_secs() const { return m_base_secs; }
+  uint32_t newest_secs() const { return m_last_secs; }
+
+  // Summarize samples in [start_secs, end_secs) into `num_buckets` buckets of equal width.
+  // Buckets without samples have count == 0.  Returns the number of samples summarized.
+  size_t query(uint32_t start_secs, uint32_t end_secs, Bucket* buckets, size_t num_buckets) const;
+
+  // Calls fn(secs, value, is_valid) for each sample from oldest to newest.
+  template <typename Fn>
+  void for_each(Fn fn) const;
+
+  // Persistence: spill the history to a JSON object, or restore it from one.
+  void write_json(JsonObject obj) const;
+  bool read_json(JsonObjectConst obj);
+
+  void clear();
+
+ private:
+  struct Entry {
+    uint16_t dt_secs;
+    int16_t dv;
+  };
+  static constexpr int16_t kGap = INT16_MIN;
+
+  int32_t quantize(float value) const;
+  float dequantize(int32_t q) const { return static_cast<float>(q) / m_scale; }
+  void push(uint32_t secs, int32_t q, bool is_gap);
+  void append(const Entry& entry);
+
+  const unsigned m_decimals;
+  const float m_scale;
+  std::vector<Entry> m_entries;
+  size_t m_head = 0;  // index of the oldest sample
+  size_t m_size = 0;
+  size_t m_num_valid = 0;  // number of samples which are not gaps
+  // Reconstructed time and value of the oldest sample.
+  uint32_t m_base_secs = 0;
+  int32_t m_base_q = 0;
+  // Reconstructed time and value of the newest sample.
+  uint32_t m_last_secs = 0;
+  int32_t m_last_q = 0;
+};
+
+template <typename Fn>
+void SensorHistory::for_each(Fn fn) const {
+  uint32_t secs = m_base_secs;
+  int32_t q = m_base_q;
+  for (size_t i = 0; i < m_size; i++) {
+    const Entry& entry = m_entries[(m_head + i) % m_entries.size()];
+    if (i > 0) {
+      secs += entry.dt_secs;
+      if (entry.dv != kGap) {
+        q += entry.dv;
+      }
+    }
+    fn(secs, dequantize(q), entry.dv != kGap);
+  }
+}
+
+}  // namespace og3::base_station
@@ -0,0 +1,52 @@
+// Copyright (c) 2026 Chris Lee and contributors.
+// Licensed under the MIT license. See LICENSE file in the project root for details.
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+namespace og3::base_station {
+
+// A bump allocator for strings, which are all freed at once when the arena is destroyed.
+// Strings are packed into chunks so that many small names don't fragment the heap.  A string
+// longer than a chunk gets a chunk of its own.
+class StringArena {
+ public:
+  static constexpr size_t kDefaultChunkSize = 128;
+
+  explicit StringArena(size_t chunk_size = kDefaultChunkSize) : m_chunk_size(chunk_size) {}
+  ~StringArena();
+  StringArena(const StringArena&) = delete;
+  StringArena& operator=(const StringArena&) = delete;
+
+  // Copy a string into the arena.  The result is valid until the arena is destroyed.
+  const char* add(const char* str);
+  const char* add(const char* str, size_t len);
+  // Allocate `len + 1` bytes, for a string of length `len` to be written by the caller.
+  char* alloc(size_t len);
+
+  size_t bytes_allocated() const { return m_bytes_allocated; }
+
+ private:
+  // Each chunk starts with a pointer to the previous chunk, followed by string data.
+  char* m_chunk = nullptr;
+  size_t m_chunk_used = 0;
+  size_t m_chunk_capacity = 0;
+  size_t m_bytes_allocated = 0;
+  const size_t m_chunk_size;
+};
+
+// Interned strings which are shared by all devices and never freed, for values which repeat
+// across many sensors such as units, device classes and manufacturer names.
+class StringPool {
+ public:
+  // Returns a pointer to a string equal to `str`, which is valid for the life of the program.
+  static const char* intern(const char* str);
+
+ private:
+  StringArena m_arena{256};
+  std::vector<const char*> m_strings;  // sorted
+};
+
+}  // namespace og3::base_station
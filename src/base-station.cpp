@@ -3,6 +3,12 @@
 
 #include <og3/base-station.h>
 #include <og3/config_interface.h>
+#include <og3/satellite-common.h>
+#include <og3/units.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
 
 namespace og3::base_station {
 namespace {
@@ -23,9 +29,14 @@ void make_legal(char* name, size_t len) {
   }
 }
 
-std::string legalize(const char* name) {
-  std::string lname(name);
-  make_legal(&lname[0], lname.length());
+const char* legalize(const char* name, StringArena& arena) {
+  if (!name) {
+    name = "";
+  }
+  const size_t len = strlen(name);
+  char* lname = arena.alloc(len);
+  memcpy(lname, name, len + 1);
+  make_legal(lname, len);
   return lname;
 }
 
@@ -35,35 +46,132 @@ void make_entry_name(char* entry_name, size_t entry_name_size, const char* devic
   make_legal(entry_name, len);
 }
 
-std::string _manufacturer(uint32_t id) {
+const char* _manufacturer(uint32_t id) {
   switch (id) {
     case kC133Org:
-      return "c133 org";
+      return StringPool::intern("c133 org");
     default:
       break;
   }
 
   char buffer[32];
   snprintf(buffer, sizeof(buffer), "manufacturer_%04x", id);
-  return buffer;
+  return StringPool::intern(buffer);
 }
 
-std::string _device_id(const char* name, uint32_t device_id) {
+const char* _device_id(const char* name, uint32_t device_id, StringArena& arena) {
   char buffer[80];
   const auto len = snprintf(buffer, sizeof(buffer), "%s_%x", name, device_id);
-  return std::string(buffer, len);
+  return arena.add(buffer, std::min<size_t>(len, sizeof(buffer) - 1));
+}
+
+// The "disabled" setting of each device is registered in the app's config VariableGroup,
+// which keeps a pointer to it.  These are kept for the life of the program, so that a device
+// can be demoted to a DormantDevice and woken again without leaving a dangling variable or
+// registering a duplicate.
+BoolVariable& disabled_setting(uint32_t device_id_num, const char* name, VariableGroup& cvg) {
+  static StringArena s_arena;
+  static std::map<uint32_t, std::unique_ptr<BoolVariable>> s_settings;
+  auto iter = s_settings.find(device_id_num);
+  if (iter != s_settings.end()) {
+    return *iter->second;
+  }
+  char buffer[80];
+  const auto len = snprintf(buffer, sizeof(buffer), "%s_disabled", name);
+  const char* var_name = s_arena.add(buffer, std::min<size_t>(len, sizeof(buffer) - 1));
+  auto* setting = new BoolVariable(var_name, false, nullptr, VariableBase::kSettable, cvg);
+  s_settings.emplace(device_id_num, setting);
+  return *setting;
+}
+
+uint32_t millis_clock() { return millis() / 1000; }
+
+Sensor::ClockFn s_clock_fn = millis_clock;
+
+void history_filename(char* out, size_t out_size, const char* prefix, char type, unsigned id) {
+  snprintf(out, out_size, "%s_%c%u", prefix, type, id);
+}
+
+bool save_history(const SensorHistory* history, const char* filename, ConfigInterface* config) {
+  if (!history) {
+    return true;
+  }
+  JsonDocument doc;
+  history->write_json(doc.to<JsonObject>());
+  std::string content;
+  serializeJson(doc, content);
+  return config->write_file(filename, content.c_str());
+}
+
+// Restore a history spilled to flash, unless it is from the future according to our clock.
+bool load_history(SensorHistory* history, const char* filename, ConfigInterface* config) {
+  if (!history) {
+    return true;
+  }
+  String content;
+  if (!config->read_file(filename, &content)) {
+    return false;
+  }
+  JsonDocument doc;
+  if (deserializeJson(doc, content.c_str())) {
+    return false;
+  }
+  if (!history->read_json(doc.as<JsonObjectConst>()) ||
+      history->newest_secs() > Sensor::now_secs()) {
+    history->clear();
+    return false;
+  }
+  return true;
 }
 
 }  // namespace
 
 Sensor::Sensor(const char* name, const char* device_class, const char* units, Device* device,
                og3_Sensor_StateClass state_class)
-    : m_name(legalize(name)),
-      m_device_class(device_class ? device_class : ""),
-      m_units(units),
-      m_description(name),
+    : m_name(legalize(name, device->arena())),
+      m_device_class(StringPool::intern(device_class)),
+      m_units(StringPool::intern(units)),
+      m_description((!name || strcmp(name, m_name) == 0) ? m_name : device->arena().add(name)),
       m_state_class(state_class),
-      m_device(device) {}
+      m_device(device),
+      m_aggregator(default_aggregation(state_class)) {}
+
+SensorAggregator::Config Sensor::default_aggregation(og3_Sensor_StateClass state_class) {
+  SensorAggregator::Config config;
+  if (state_class == og3_Sensor_StateClass_STATE_CLASS_MEASUREMENT) {
+    config.window_secs = SensorAggregator::kDefaultWindowSecs;
+  }
+  return config;
+}
+
+void Sensor::set_clock(ClockFn clock_fn) { s_clock_fn = clock_fn ? clock_fn : millis_clock; }
+
+uint32_t Sensor::now_secs() { return s_clock_fn(); }
+
+bool Sensor::has_wall_clock() { return s_clock_fn != millis_clock; }
+
+bool Sensor::write_history_json(JsonObject obj, uint32_t start_secs, uint32_t end_secs,
+                                size_t num_buckets) const {
+  if (!m_history || num_buckets == 0) {
+    return false;
+  }
+  std::vector<SensorHistory::Bucket> buckets(num_buckets);
+  m_history->query(start_secs, end_secs, buckets.data(), buckets.size());
+  JsonArray t = obj["t"].to<JsonArray>();
+  JsonArray mins = obj["min"].to<JsonArray>();
+  JsonArray maxs = obj["max"].to<JsonArray>();
+  JsonArray avgs = obj["avg"].to<JsonArray>();
+  for (const auto& bucket : buckets) {
+    if (bucket.count == 0) {
+      continue;
+    }
+    t.add(bucket.start_secs);
+    mins.add(bucket.min);
+    maxs.add(bucket.max);
+    avgs.add(bucket.avg);
+  }
+  return true;
+}
 
 void Sensor::addHAEntry(HADiscovery::Entry& entry) {
   switch (m_state_class) {
@@ -73,43 +181,116 @@ void Sensor::addHAEntry(HADiscovery::Entry& entry) {
       entry.state_class = "measurement";
       break;
   }
-  m_device->addHAEntry(entry, name().c_str());
+  m_device->addHAEntry(entry, name());
 }
 
 FloatSensor::FloatSensor(const char* name, const char* device_class, const char* units,
                          unsigned decimals, Device* device, og3_Sensor_StateClass state_class)
     : Sensor(name, device_class, units, device, state_class),
-      m_value(m_name.c_str(), 0.0f, m_units.c_str(), "", 0, decimals, device->vg()) {
-  HADiscovery::Entry entry(m_value, ha::device_type::kSensor, m_device_class.c_str());
+      m_value(m_name, 0.0f, m_units, "", 0, decimals, device->vg()) {
+  HADiscovery::Entry entry(m_value, ha::device_type::kSensor, m_device_class);
   addHAEntry(entry);
 }
 
+bool FloatSensor::set_value(float value) {
+  const uint32_t secs = now_secs();
+  if (m_history) {
+    m_history->add(secs, value);
+  }
+  float out;
+  if (!m_aggregator.add(secs, value, &out)) {
+    return false;
+  }
+  m_value = out;
+  return true;
+}
+
+bool FloatSensor::flush_aggregation() {
+  float out;
+  if (!m_aggregator.flush(now_secs(), &out)) {
+    return false;
+  }
+  m_value = out;
+  return true;
+}
+
+void FloatSensor::set_failed() {
+  m_value.setFailed();
+  m_aggregator.reset();
+  if (m_history) {
+    m_history->add_gap(now_secs());
+  }
+}
+
+SensorHistory* FloatSensor::enable_history(size_t capacity) {
+  if (!m_history) {
+    m_history.reset(new SensorHistory(m_value.decimals(), capacity));
+  }
+  return m_history.get();
+}
+
 IntSensor::IntSensor(const char* name, const char* device_class, const char* units, Device* device,
                      og3_Sensor_StateClass state_class)
     : Sensor(name, device_class, units, device, state_class),
-      m_value(m_name.c_str(), 0, m_units.c_str(), "", 0, device->vg()) {
-  HADiscovery::Entry entry(m_value, ha::device_type::kSensor, m_device_class.c_str());
+      m_value(m_name, 0, m_units, "", 0, device->vg()) {
+  HADiscovery::Entry entry(m_value, ha::device_type::kSensor, m_device_class);
   addHAEntry(entry);
 }
 
+bool IntSensor::set_value(int value) {
+  const uint32_t secs = now_secs();
+  if (m_history) {
+    m_history->add(secs, value);
+  }
+  float out;
+  if (!m_aggregator.add(secs, value, &out)) {
+    return false;
+  }
+  m_value = static_cast<int>(lroundf(out));
+  return true;
+}
+
+bool IntSensor::flush_aggregation() {
+  float out;
+  if (!m_aggregator.flush(now_secs(), &out)) {
+    return false;
+  }
+  m_value = static_cast<int>(lroundf(out));
+  return true;
+}
+
+void IntSensor::set_failed() {
+  m_value.setFailed();
+  m_aggregator.reset();
+  if (m_history) {
+    m_history->add_gap(now_secs());
+  }
+}
+
+SensorHistory* IntSensor::enable_history(size_t capacity) {
+  if (!m_history) {
+    m_history.reset(new SensorHistory(0, capacity));
+  }
+  return m_history.get();
+}
+
 Device::Device(uint32_t device_id_num, const char* name, uint32_t mfg_id, const char* device_type,
                ModuleSystem* module_system, HADiscovery* ha_discovery, uint16_t seq_id,
                VariableGroup& cvg)
     : m_device_id_num(device_id_num),
-      m_name(name),
-      m_device_id(_device_id(name, device_id_num)),
+      m_name(m_arena.add(name)),
+      m_device_id(_device_id(name, device_id_num, m_arena)),
       m_mfg_id(mfg_id),
       m_manufacturer(_manufacturer(mfg_id)),
-      m_device_type(device_type),
+      m_device_type(StringPool::intern(device_type)),
       m_hw_version(og3_Version_init_zero),
       m_sw_version(og3_Version_init_zero),
       m_seq_id(seq_id),
       m_discovery(ha_discovery),
-      m_vg(m_name.c_str(), m_device_id.c_str()),
+      m_vg(m_name, m_device_id),
       m_dropped_packets("dropped_packets", 0, "count", "dropped packets", 0, m_vg),
       m_rssi("RSSI", 0, "dB", "", 0, m_vg),
-      m_str_disabled(m_name + "_disabled"),
-      m_disabled(m_str_disabled.c_str(), false, nullptr, VariableBase::kSettable, cvg) {
+      m_disabled(disabled_setting(device_id_num, name, cvg)) {
   JsonDocument json;
   auto make_ha_entry = [&json, this](const VariableBase& var, const char* device_type,
                                      const char* device_class) {
@@ -129,59 +310,52 @@ void Device::set_mfg_id(uint32_t mfg_id) {
 
 bool Device::saveAll(const char* filename, ConfigInterface* config,
                      const std::map<uint32_t, std::unique_ptr<Device>>& devices) {
+  return saveAll(filename, config, devices, DormantDeviceMap());
+}
+
+bool Device::saveAll(const char* filename, ConfigInterface* config, const DeviceMap& devices,
+                     const DormantDeviceMap& dormant) {
   if (!config) {
     return false;
   }
   JsonDocument doc;
   JsonArray arr = doc.to<JsonArray>();
+  // The document may refer to strings in the records' arenas, so keep them until serialized.
+  std::vector<std::unique_ptr<DormantDevice>> records;
+  records.reserve(devices.size());
   for (auto& iter : devices) {
-    const auto& device = iter.second;
-    JsonObject obj = arr.add<JsonObject>();
-    obj["id"] = device->id_num();
-    obj["name"] = device->name();
-    obj["mfg"] = device->mfg_id();
-    obj["type"] = device->device_type();
-    obj["timeout"] = device->comms_timeout_millis();
-    obj["hwMaj"] = device->hardware_version().major;
-    obj["hwMin"] = device->hardware_version().minor;
-    obj["hwPat"] = device->hardware_version().patch;
-    obj["swMaj"] = device->software_version().major;
-    obj["swMin"] = device->software_version().minor;
-    obj["swPat"] = device->software_version().patch;
-
-    JsonArray sensors = obj["sensors"].to<JsonArray>();
-    for (auto& siter : device->id_to_float_sensor()) {
-      const auto& s = siter.second;
-      JsonObject sobj = sensors.add<JsonObject>();
-      sobj["id"] = siter.first;
-      sobj["type"] = "float";
-      sobj["name"] = s->name();
-      sobj["class"] = s->device_class();
-      sobj["units"] = s->units();
-      sobj["decimals"] = s->value().decimals();
-      sobj["state"] = static_cast<int>(s->state_class());
-    }
-    for (auto& siter : device->id_to_int_sensor()) {
-      const auto& s = siter.second;
-      JsonObject sobj = sensors.add<JsonObject>();
-      sobj["id"] = siter.first;
-      sobj["type"] = "int";
-      sobj["name"] = s->name();
-      sobj["class"] = s->device_class();
-      sobj["units"] = s->units();
-      sobj["state"] = static_cast<int>(s->state_class());
+    records.emplace_back(new DormantDevice(*iter.second));
+    records.back()->write_json(arr.add<JsonObject>());
+  }
+  for (auto& iter : dormant) {
+    // A live device is newer than a dormant record left behind for it (e.g., if the app woke it
+    // without wake()), so only the live one is saved.
+    if (devices.count(iter.first) == 0) {
+      iter.second->write_json(arr.add<JsonObject>());
     }
   }
   std::string content;
   serializeJson(doc, content);
   bool ok = config->write_file(filename, content.c_str());
-  config->log()->logf("Saved %u satellite devices to %s: %s", (unsigned)devices.size(), filename,
+  config->log()->logf("Saved %u satellite devices to %s: %s", (unsigned)arr.size(), filename,
                       ok ? "OK" : "FAILED");
   return ok;
 }
 
 bool Device::loadAll(const char* filename, ConfigInterface* config, CreateDeviceFn create_fn) {
-  if (!config) {
+  DormantDeviceMap dormant;
+  if (!loadDormant(filename, config, &dormant)) {
+    return false;
+  }
+  for (auto& iter : dormant) {
+    iter.second->wake(create_fn);
+  }
+  return true;
+}
+
+bool Device::loadDormant(const char* filename, ConfigInterface* config,
+                         DormantDeviceMap* dormant) {
+  if (!config || !dormant) {
     return false;
   }
   String content;
@@ -195,32 +369,154 @@ bool Device::loadAll(const char* filename, ConfigInterface* config, CreateDevice
     config->log()->logf("Failed to parse satellite devices from %s: %s", filename, error.c_str());
     return false;
   }
-  JsonArray arr = doc.as<JsonArray>();
-  for (JsonObject obj : arr) {
-    og3_Version hw = {obj["hwMaj"], obj["hwMin"], obj["hwPat"]};
-    og3_Version sw = {obj["swMaj"], obj["swMin"], obj["swPat"]};
-    Device* pdevice =
-        create_fn(obj["id"], obj["name"], obj["mfg"], obj["type"], obj["timeout"], hw, sw);
-    if (pdevice) {
-      JsonArray sensors = obj["sensors"].as<JsonArray>();
-      for (JsonObject sobj : sensors) {
-        const char* type = sobj["type"];
-        unsigned id = sobj["id"];
-        const char* name = sobj["name"];
-        const char* dclass = sobj["class"];
-        const char* units = sobj["units"];
-        og3_Sensor_StateClass state = static_cast<og3_Sensor_StateClass>(sobj["state"].as<int>());
-        if (strcmp(type, "float") == 0) {
-          pdevice->add_float_sensor(id, name, dclass, units, sobj["decimals"], pdevice, state);
-        } else if (strcmp(type, "int") == 0) {
-          pdevice->add_int_sensor(id, name, dclass, units, pdevice, state);
-        }
-      }
-    }
+  JsonArrayConst arr = doc.as<JsonArrayConst>();
+  for (JsonObjectConst obj : arr) {
+    std::unique_ptr<DormantDevice> device(new DormantDevice(obj));
+    const uint32_t id = device->id_num();
+    (*dormant)[id] = std::move(device);
   }
   config->log()->logf("Loaded %u satellite devices from %s.", (unsigned)arr.size(), filename);
   return true;
 }
+
+Device* Device::wake(uint32_t id, DormantDeviceMap* dormant, CreateDeviceFn create_fn) {
+  auto iter = dormant->find(id);
+  if (iter == dormant->end()) {
+    return nullptr;
+  }
+  Device* device = iter->second->wake(create_fn);
+  if (device) {
+    // Keep the record if the app could not create the device, so it is not lost on save.
+    dormant->erase(iter);
+  }
+  return device;
+}
+
+unsigned Device::demoteIdle(uint32_t idle_millis, DeviceMap* devices, DormantDeviceMap* dormant) {
+  unsigned num_demoted = 0;
+  const uint32_t now = millis();
+  for (auto iter = devices->begin(); iter != devices->end();) {
+    Device& device = *iter->second;
+    if (now - device.last_packet_millis() <= idle_millis) {
+      ++iter;
+      continue;
+    }
+    device.setIsOnline(false);
+    (*dormant)[iter->first].reset(new DormantDevice(device));
+    iter = devices->erase(iter);
+    num_demoted += 1;
+  }
+  return num_demoted;
+}
+
+FloatSensor* Device::add_float_sensor(unsigned id, const char* name, const char* device_class,
+                                      const char* units, unsigned decimals, Device* device,
+                                      og3_Sensor_StateClass state_class) {
+  auto iter = m_id_to_float_sensor.emplace(
+      id, new FloatSensor(name, device_class, units, decimals, this, state_class));
+  FloatSensor* sensor = iter.first->second.get();
+  if (iter.second && m_history_capacity > 0) {
+    sensor->enable_history(m_history_capacity);
+  }
+  if (iter.second && m_aggregation) {
+    sensor->set_aggregation(*m_aggregation);
+  }
+  return sensor;
+}
+
+IntSensor* Device::add_int_sensor(unsigned id, const char* name, const char* device_class,
+                                  const char* units, Device* device,
+                                  og3_Sensor_StateClass state_class) {
+  auto iter =
+      m_id_to_int_sensor.emplace(id, new IntSensor(name, device_class, units, this, state_class));
+  IntSensor* sensor = iter.first->second.get();
+  if (iter.second && m_history_capacity > 0) {
+    sensor->enable_history(m_history_capacity);
+  }
+  if (iter.second && m_aggregation) {
+    sensor->set_aggregation(*m_aggregation);
+  }
+  return sensor;
+}
+
+void Device::enable_history(size_t capacity) {
+  m_history_capacity = capacity;
+  for (auto& iter : m_id_to_float_sensor) {
+    iter.second->enable_history(capacity);
+  }
+  for (auto& iter : m_id_to_int_sensor) {
+    iter.second->enable_history(capacity);
+  }
+}
+
+void Device::set_aggregation(const SensorAggregator::Config& config) {
+  m_aggregation.reset(new SensorAggregator::Config(config));
+  for (auto& iter : m_id_to_float_sensor) {
+    iter.second->set_aggregation(config);
+  }
+  for (auto& iter : m_id_to_int_sensor) {
+    iter.second->set_aggregation(config);
+  }
+}
+
+bool Device::flush_aggregation() {
+  bool updated = false;
+  for (auto& iter : m_id_to_float_sensor) {
+    updated = iter.second->flush_aggregation() || updated;
+  }
+  for (auto& iter : m_id_to_int_sensor) {
+    updated = iter.second->flush_aggregation() || updated;
+  }
+  return updated;
+}
+
+bool Device::saveHistory(const char* prefix, ConfigInterface* config) const {
+  if (!config) {
+    return false;
+  }
+  if (!Sensor::has_wall_clock()) {
+    // A spill timestamped by millis() can't be placed on the timeline after a reboot.
+    config->log()->logf("Not saving sensor history of %s: no wall clock.", cname());
+    return false;
+  }
+  // One file per sensor keeps the JSON document and serialized content small.
+  char filename[64];
+  bool ok = true;
+  for (auto& iter : m_id_to_float_sensor) {
+    history_filename(filename, sizeof(filename), prefix, 'f', iter.first);
+    ok = save_history(iter.second->history(), filename, config) && ok;
+  }
+  for (auto& iter : m_id_to_int_sensor) {
+    history_filename(filename, sizeof(filename), prefix, 'i', iter.first);
+    ok = save_history(iter.second->history(), filename, config) && ok;
+  }
+  config->log()->logf("Saved sensor history of %s to %s_*: %s", cname(), prefix,
+                      ok ? "OK" : "FAILED");
+  return ok;
+}
+
+bool Device::loadHistory(const char* prefix, ConfigInterface* config) {
+  if (!config) {
+    return false;
+  }
+  if (!Sensor::has_wall_clock()) {
+    config->log()->logf("Not loading sensor history of %s: no wall clock.", cname());
+    return false;
+  }
+  char filename[64];
+  unsigned num_loaded = 0;
+  for (auto& iter : m_id_to_float_sensor) {
+    history_filename(filename, sizeof(filename), prefix, 'f', iter.first);
+    num_loaded += load_history(iter.second->history(), filename, config) ? 1 : 0;
+  }
+  for (auto& iter : m_id_to_int_sensor) {
+    history_filename(filename, sizeof(filename), prefix, 'i', iter.first);
+    num_loaded += load_history(iter.second->history(), filename, config) ? 1 : 0;
+  }
+  config->log()->logf("Loaded %u sensor histories of %s from %s_*.", num_loaded, cname(), prefix);
+  return num_loaded > 0;
+}
+
 void Device::got_packet(uint16_t seq_id, int rssi) {
   if (seq_id > m_seq_id) {
     m_dropped_packets = m_dropped_packets.value() + static_cast<int>(seq_id) - 1 - m_seq_id;
@@ -244,8 +540,8 @@ void Device::got_packet(uint16_t seq_id, int rssi) {
 void Device::addHAEntry(HADiscovery::Entry& entry, const char* sensor_name) {
   entry.device_name = cname();
   entry.device_id = cdevice_id();
-  entry.manufacturer = manufacturer().c_str();
-  if (!m_device_type.empty()) {
+  entry.manufacturer = manufacturer();
+  if (m_device_type[0]) {
     entry.model = cdevice_type();
   }
   char entry_name[80];
@@ -261,6 +557,7 @@ void Device::addHAEntry(HADiscovery::Entry& entry, const char* sensor_name) {
   // TODO(chrishl): should bookkeep and send again if this fails.
   ha_discovery().addEntry(&json, entry);
 }
+
 void Device::setAllSensorReadingsFailed() {
   for (auto& iter : m_id_to_float_sensor) {
     iter.second->set_failed();
@@ -287,6 +584,68 @@ void Device::setIsOnline(bool is_online) {
   mqtt->mqttSend(mqtt->topic(availability).c_str(), is_online ? "online" : "offline");
 }
 
+void Device::set_report_interval_secs(uint32_t secs) {
+  m_downlink_config.report_interval_secs = secs;
+  m_downlink_config.changed();
+}
+
+void Device::set_batch_size(uint32_t batch_size) {
+  m_downlink_config.batch_size = batch_size;
+  m_downlink_config.changed();
+}
+
+void Device::request_desc_resend() {
+  m_downlink_config.resend_desc = true;
+  m_downlink_config.changed();
+}
+
+void Device::DownlinkConfig::changed() {
+  // The satellite may have acknowledged an id newer than ours, e.g., if this config was not
+  // saved before the base station restarted, so move past both.
+  id = std::max(id, acked_id) + 1;
+  if (id == 0) {
+    id = 1;
+  }
+}
+
+bool Device::DownlinkConfig::make_downlink(uint32_t device_id, og3_Downlink& downlink) const {
+  if (!is_pending()) {
+    return false;
+  }
+  downlink = og3_Downlink_init_zero;
+  downlink.device_id = device_id;
+  downlink.config_id = id;
+  downlink.report_interval_secs = report_interval_secs;
+  downlink.batch_size = batch_size;
+  downlink.resend_desc = resend_desc;
+  return true;
+}
+
+bool Device::DownlinkConfig::got_ack(uint32_t config_id) {
+  // Always record what the satellite reports, so that if it loses its configuration (e.g., its
+  // RTC memory is wiped) the downlink becomes pending again.
+  acked_id = config_id;
+  if (id == 0 || is_pending()) {
+    return false;
+  }
+  resend_desc = false;
+  return true;
+}
+
+bool Device::make_downlink(og3_Downlink& downlink) const {
+  return m_downlink_config.make_downlink(m_device_id_num, downlink);
+}
+
+void Device::got_downlink_ack(uint32_t config_id) {
+  if (!m_downlink_config.got_ack(config_id)) {
+    return;
+  }
+  const uint64_t timeout_millis =
+      uint64_t{report_timeout_secs(m_downlink_config.report_interval_secs)} * kMsecInSec;
+  m_comms_timeout_millis = static_cast<uint32_t>(
+      std::max<uint64_t>(m_comms_timeout_millis, std::min<uint64_t>(timeout_millis, UINT32_MAX)));
+}
+
 bool Device::isTimedOut() const {
   if (!m_is_online) {
     return true;
@@ -295,4 +654,116 @@ bool Device::isTimedOut() const {
   return elapsed > m_comms_timeout_millis;
 }
 
+DormantDevice::DormantDevice(const Device& device)
+    : m_device_id_num(device.id_num()),
+      m_name(m_arena.add(device.name())),
+      m_mfg_id(device.mfg_id()),
+      m_device_type(device.device_type()),
+      m_comms_timeout_millis(device.comms_timeout_millis()),
+      m_hw_version(device.hardware_version()),
+      m_sw_version(device.software_version()),
+      m_downlink_config(device.downlink_config()) {
+  m_sensors.reserve(device.id_to_float_sensor().size() + device.id_to_int_sensor().size());
+  for (auto& iter : device.id_to_float_sensor()) {
+    const auto& s = iter.second;
+    m_sensors.push_back({iter.first, true, static_cast<unsigned>(s->value().decimals()),
+                         s->state_class(), m_arena.add(s->name()), s->device_class(), s->units()});
+  }
+  for (auto& iter : device.id_to_int_sensor()) {
+    const auto& s = iter.second;
+    m_sensors.push_back({iter.first, false, 0, s->state_class(), m_arena.add(s->name()),
+                         s->device_class(), s->units()});
+  }
+}
+
+DormantDevice::DormantDevice(JsonObjectConst obj)
+    : m_device_id_num(obj["id"]),
+      m_name(m_arena.add(obj["name"].as<const char*>())),
+      m_mfg_id(obj["mfg"]),
+      m_device_type(StringPool::intern(obj["type"].as<const char*>())),
+      m_comms_timeout_millis(obj["timeout"]),
+      m_hw_version({obj["hwMaj"].as<uint32_t>(), obj["hwMin"].as<uint32_t>(),
+                    obj["hwPat"].as<uint32_t>()}),
+      m_sw_version({obj["swMaj"].as<uint32_t>(), obj["swMin"].as<uint32_t>(),
+                    obj["swPat"].as<uint32_t>()}) {
+  JsonObjectConst dobj = obj["downlink"].as<JsonObjectConst>();
+  if (!dobj.isNull()) {
+    m_downlink_config.id = dobj["id"];
+    m_downlink_config.report_interval_secs = dobj["interval"];
+    m_downlink_config.batch_size = dobj["batch"];
+    m_downlink_config.resend_desc = dobj["resend"];
+    m_downlink_config.acked_id = dobj["ack"];
+  }
+  JsonArrayConst sensors = obj["sensors"].as<JsonArrayConst>();
+  m_sensors.reserve(sensors.size());
+  for (JsonObjectConst sobj : sensors) {
+    const char* type = sobj["type"] | "";
+    const bool is_float = (strcmp(type, "float") == 0);
+    if (!is_float && strcmp(type, "int") != 0) {
+      continue;
+    }
+    const unsigned decimals = is_float ? sobj["decimals"].as<unsigned>() : 0;
+    m_sensors.push_back({sobj["id"].as<unsigned>(), is_float, decimals,
+                         static_cast<og3_Sensor_StateClass>(sobj["state"].as<int>()),
+                         m_arena.add(sobj["name"].as<const char*>()),
+                         StringPool::intern(sobj["class"].as<const char*>()),
+                         StringPool::intern(sobj["units"].as<const char*>())});
+  }
+}
+
+void DormantDevice::write_json(JsonObject obj) const {
+  obj["id"] = m_device_id_num;
+  obj["name"] = m_name;
+  obj["mfg"] = m_mfg_id;
+  obj["type"] = m_device_type;
+  obj["timeout"] = m_comms_timeout_millis;
+  obj["hwMaj"] = m_hw_version.major;
+  obj["hwMin"] = m_hw_version.minor;
+  obj["hwPat"] = m_hw_version.patch;
+  obj["swMaj"] = m_sw_version.major;
+  obj["swMin"] = m_sw_version.minor;
+  obj["swPat"] = m_sw_version.patch;
+  if (m_downlink_config.id) {
+    JsonObject dobj = obj["downlink"].to<JsonObject>();
+    dobj["id"] = m_downlink_config.id;
+    dobj["ack"] = m_downlink_config.acked_id;
+    dobj["interval"] = m_downlink_config.report_interval_secs;
+    dobj["batch"] = m_downlink_config.batch_size;
+    dobj["resend"] = m_downlink_config.resend_desc;
+  }
+
+  JsonArray sensors = obj["sensors"].to<JsonArray>();
+  for (const auto& sensor : m_sensors) {
+    JsonObject sobj = sensors.add<JsonObject>();
+    sobj["id"] = sensor.id;
+    sobj["type"] = sensor.is_float ? "float" : "int";
+    sobj["name"] = sensor.name;
+    sobj["class"] = sensor.device_class;
+    sobj["units"] = sensor.units;
+    if (sensor.is_float) {
+      sobj["decimals"] = sensor.decimals;
+    }
+    sobj["state"] = static_cast<int>(sensor.state_class);
+  }
+}
+
+Device* DormantDevice::wake(Device::CreateDeviceFn create_fn) const {
+  Device* pdevice = create_fn(m_device_id_num, m_name, m_mfg_id, m_device_type,
+                              m_comms_timeout_millis, m_hw_version, m_sw_version);
+  if (!pdevice) {
+    return nullptr;
+  }
+  pdevice->m_downlink_config = m_downlink_config;
+  for (const auto& sensor : m_sensors) {
+    if (sensor.is_float) {
+      pdevice->add_float_sensor(sensor.id, sensor.name, sensor.device_class, sensor.units,
+                                sensor.decimals, pdevice, sensor.state_class);
+    } else {
+      pdevice->add_int_sensor(sensor.id, sensor.name, sensor.device_class, sensor.units, pdevice,
+                              sensor.state_class);
+    }
+  }
+  return pdevice;
+}
+
 }  // namespace og3::base_station
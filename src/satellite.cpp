@@ -3,8 +3,13 @@
 
 #include "og3/satellite.h"
 
+#include <ArduinoJson.h>
+#include <pb_decode.h>
 #include <pb_encode.h>
 
+#include <algorithm>
+#include <string>
+
 #define SETSTR(X, VAL) strncpy(X, (VAL), sizeof(X) - 1)
 
 namespace og3::satellite {
@@ -12,7 +17,7 @@ namespace og3::satellite {
 bool PacketFloatReading::write(og3_Packet& packet) {
   auto& reading = packet.reading[packet.reading_count];
   reading.sensor_id = m_sensor_id;
-  reading.value = m_var.value();
+  reading.value = value();
   packet.reading_count += 1;
   return true;
 }
@@ -28,6 +33,46 @@ bool PacketFloatReading::write_desc(og3_Packet& packet) {
   return true;
 }
 
+Oversampler::Oversampler(unsigned num_samples)
+    : m_num_samples(std::clamp(num_samples, 1u, kMaxSamples)) {}
+
+void Oversampler::add(float sample) {
+  if (m_count < kMaxSamples) {
+    m_samples[m_count] = sample;
+    m_count += 1;
+  }
+}
+
+float Oversampler::value() const {
+  if (m_count == 0) {
+    return 0.0f;
+  }
+  float sorted[kMaxSamples];
+  std::copy(m_samples, m_samples + m_count, sorted);
+  std::sort(sorted, sorted + m_count);
+  const unsigned trim = m_count / 4;
+  float sum = 0.0f;
+  for (unsigned i = trim; i < m_count - trim; i++) {
+    sum += sorted[i];
+  }
+  return sum / (m_count - 2 * trim);
+}
+
+bool PacketVoltageReading::read() {
+  // ADC conversions take microseconds, so samples are taken back-to-back rather than spread
+  // over polls, which keeps them close together in time.
+  m_sampler.reset();
+  while (!m_sampler.is_done()) {
+    m_adc.read();
+    m_sampler.add(m_var.value());
+  }
+  return true;
+}
+
+float PacketVoltageReading::value() const {
+  return (m_sampler.count() > 0) ? m_sampler.value() : m_var.value();
+}
+
 bool PacketIntReading::write(og3_Packet& packet) {
   auto& reading = packet.i_reading[packet.i_reading_count];
   reading.sensor_id = m_sensor_id;
@@ -90,7 +135,50 @@ void PacketSender::send_all_readings() {
   for (auto& fr : m_readings) {
     fr->read();
   }
-  m_app->log().debug("PacketSender::update() preparing packet.");
+  send_readings_packet();
+}
+
+void PacketSender::acquire_and_send_readings(std::function<void()> on_sent) {
+  if (m_is_acquiring) {
+    return;
+  }
+  m_is_acquiring = true;
+  m_on_sent = on_sent;
+  m_read_done.assign(m_readings.size(), false);
+  start_radio();
+  for (auto& fr : m_readings) {
+    fr->start_read();
+  }
+  poll_readings();
+}
+
+void PacketSender::poll_readings() {
+  bool all_done = true;
+  for (size_t i = 0; i < m_readings.size(); i++) {
+    if (!m_read_done[i]) {
+      m_read_done[i] = m_readings[i]->poll_read();
+      all_done = all_done && m_read_done[i];
+    }
+  }
+  if (!all_done) {
+    if (m_app) {
+      m_app->tasks().runIn(kPollMsec, [this]() { poll_readings(); });
+    }
+    return;
+  }
+  send_readings_packet();
+  m_is_acquiring = false;
+  auto on_sent = std::move(m_on_sent);
+  m_on_sent = nullptr;
+  if (on_sent) {
+    on_sent();
+  }
+}
+
+void PacketSender::send_readings_packet() {
+  if (m_app) {
+    m_app->log().debug("PacketSender::update() preparing packet.");
+  }
   og3_Packet packet og3_Packet_init_zero;
   // When re-sending descriptions, also include device description with first packet.
   const bool update_device = (m_rtc->sensor_descriptions_sent == 0);
@@ -107,8 +195,75 @@ void PacketSender::send_all_readings() {
   }
 }
 
+bool PacketSender::handle_downlink(const uint8_t* buf, size_t len) {
+  og3_Downlink downlink og3_Downlink_init_zero;
+  pb_istream_t stream = pb_istream_from_buffer(buf, len);
+  if (!pb_decode(&stream, &og3_Downlink_msg, &downlink)) {
+    if (m_app) {
+      m_app->log().logf("Failed to decode downlink: %s", PB_GET_ERROR(&stream));
+    }
+    return false;
+  }
+  return apply_downlink(downlink);
+}
+
+bool PacketSender::apply_downlink(const og3_Downlink& downlink) {
+  if (downlink.device_id != m_board_id) {
+    return false;
+  }
+  // Applying is idempotent, so a repeated downlink (e.g., after a lost ack) is harmless.
+  m_rtc->config_id = downlink.config_id;
+  if (downlink.report_interval_secs) {
+    m_rtc->report_interval_secs = downlink.report_interval_secs;
+  }
+  if (downlink.batch_size) {
+    m_rtc->batch_size = downlink.batch_size;
+  }
+  if (downlink.resend_desc) {
+    m_rtc->sensor_descriptions_sent = 0;
+  }
+  if (m_app) {
+    m_app->log().debugf("Applied downlink config %u: interval=%us batch=%u resend=%d",
+                        downlink.config_id, m_rtc->report_interval_secs, m_rtc->batch_size,
+                        downlink.resend_desc);
+  }
+  return true;
+}
+
+bool PacketSender::save_config(const char* filename, ConfigInterface* config) const {
+  if (!config) {
+    return false;
+  }
+  JsonDocument doc;
+  doc["id"] = m_rtc->config_id;
+  doc["interval"] = m_rtc->report_interval_secs;
+  doc["batch"] = m_rtc->batch_size;
+  std::string content;
+  serializeJson(doc, content);
+  return config->write_file(filename, content.c_str());
+}
+
+bool PacketSender::load_config(const char* filename, ConfigInterface* config) {
+  if (!config) {
+    return false;
+  }
+  String content;
+  if (!config->read_file(filename, &content)) {
+    return false;
+  }
+  JsonDocument doc;
+  if (deserializeJson(doc, content.c_str())) {
+    return false;
+  }
+  m_rtc->config_id = doc["id"];
+  m_rtc->report_interval_secs = doc["interval"];
+  m_rtc->batch_size = doc["batch"];
+  return true;
+}
+
 void PacketSender::start_packet(og3_Packet& packet, bool update_device) {
   packet.device_id = m_board_id;
+  packet.config_ack = m_rtc->config_id;
   packet.has_device = update_device;
   if (!update_device) {
     return;
@@ -126,6 +281,11 @@ void PacketSender::start_packet(og3_Packet& packet, bool update_device) {
   packet.device.has_software_version = true;
   SETSTR(packet.device.device_type, m_device->device_type);
   packet.device.timeout_secs = m_device->timeout_secs;
+  if (m_rtc->report_interval_secs) {
+    // Make sure the base station doesn't time out a satellite which was told to report slowly.
+    packet.device.timeout_secs = std::max<uint32_t>(
+        packet.device.timeout_secs, report_timeout_secs(m_rtc->report_interval_secs));
+  }
 }
 
 }  // namespace og3::satellite
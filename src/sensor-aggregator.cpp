@@ -0,0 +1,86 @@
+// Copyright (c) 2026 Chris Lee and contributors.
+// Licensed under the MIT license. See LICENSE file in the project root for details.
+
+#include "og3/sensor-aggregator.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace og3::base_station {
+
+void SensorAggregator::set_config(const Config& config) {
+  m_config = config;
+  reset();
+}
+
+bool SensorAggregator::add(uint32_t secs, float value, float* out) {
+  if (m_count == 0) {
+    m_min = m_max = value;
+    m_sum = 0.0;
+  } else {
+    m_min = std::min(m_min, value);
+    m_max = std::max(m_max, value);
+  }
+  m_last = value;
+  m_sum += value;
+  m_count += 1;
+  if (m_has_published && secs - m_window_start_secs < m_config.window_secs) {
+    return false;
+  }
+  return close(secs, out);
+}
+
+bool SensorAggregator::flush(uint32_t secs, float* out) {
+  if (m_count == 0 || secs - m_window_start_secs < m_config.window_secs) {
+    return false;
+  }
+  return close(secs, out);
+}
+
+void SensorAggregator::reset() {
+  m_count = 0;
+  m_has_published = false;
+}
+
+bool SensorAggregator::close(uint32_t secs, float* out) {
+  m_last_window.min = m_min;
+  m_last_window.max = m_max;
+  m_last_window.mean = static_cast<float>(m_sum / m_count);
+  m_last_window.last = m_last;
+  m_last_window.count = m_count;
+  m_count = 0;
+
+  float value = m_last_window.mean;
+  switch (m_config.output) {
+    case Output::kMean:
+      break;
+    case Output::kLast:
+      value = m_last_window.last;
+      break;
+    case Output::kMin:
+      value = m_last_window.min;
+      break;
+    case Output::kMax:
+      value = m_last_window.max;
+      break;
+  }
+
+  const bool is_quiet_too_long =
+      m_config.max_quiet_secs > 0 && secs - m_published_secs >= m_config.max_quiet_secs;
+  if (m_has_published && std::fabs(value - m_published) < m_config.deadband &&
+      !is_quiet_too_long) {
+    // Still start a new window so that the publish rate stays bounded.
+    m_window_start_secs = secs;
+    return false;
+  }
+  m_has_published = true;
+  m_published = value;
+  m_published_secs = secs;
+  m_window_start_secs = secs;
+  if (out) {
+    *out = value;
+  }
+  return true;
+}
+
+}  // namespace og3::base_station
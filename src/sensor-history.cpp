@@ -0,0 +1,284 @@
+// Copyright (c) 2026 Chris Lee and contributors.
+// Licensed under the MIT license. See LICENSE file in the project root for details.
+
+#include "og3/sensor-history.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <string>
+
+namespace og3::base_station {
+namespace {
+
+constexpr unsigned kMaxDecimals = 6;
+
+float scale_for(unsigned decimals) {
+  float scale = 1.0f;
+  for (unsigned i = 0; i < std::min(decimals, kMaxDecimals); i++) {
+    scale *= 10.0f;
+  }
+  return scale;
+}
+
+constexpr char kBase64[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+constexpr size_t kEntryBytes = 4;
+
+// Base64-encode `num_bytes` bytes, where byte_at(i) returns byte i.
+template <typename Fn>
+std::string base64_encode(size_t num_bytes, Fn byte_at) {
+  std::string out;
+  out.reserve((num_bytes + 2) / 3 * 4);
+  for (size_t i = 0; i < num_bytes; i += 3) {
+    uint32_t n = static_cast<uint32_t>(byte_at(i)) << 16;
+    if (i + 1 < num_bytes) {
+      n |= static_cast<uint32_t>(byte_at(i + 1)) << 8;
+    }
+    if (i + 2 < num_bytes) {
+      n |= byte_at(i + 2);
+    }
+    out += kBase64[(n >> 18) & 0x3f];
+    out += kBase64[(n >> 12) & 0x3f];
+    out += (i + 1 < num_bytes) ? kBase64[(n >> 6) & 0x3f] : '=';
+    out += (i + 2 < num_bytes) ? kBase64[n & 0x3f] : '=';
+  }
+  return out;
+}
+
+// Number of bytes encoded by a base64 string, or 0 if it is malformed.
+size_t base64_decoded_size(const char* in) {
+  size_t len = strlen(in);
+  if (len % 4 != 0) {
+    return 0;
+  }
+  size_t size = len / 4 * 3;
+  for (size_t i = 0; i < 2 && len > 0 && in[len - 1] == '='; i++, len--) {
+    size -= 1;
+  }
+  return size;
+}
+
+// Base64-decode `in`, calling emit(byte) for each byte.  Returns false if `in` is malformed.
+template <typename Fn>
+bool base64_decode(const char* in, Fn emit) {
+  uint32_t n = 0;
+  unsigned num_bits = 0;
+  for (; *in && *in != '='; in++) {
+    const char* pos = strchr(kBase64, *in);
+    if (!pos) {
+      return false;
+    }
+    n = (n << 6) | static_cast<uint32_t>(pos - kBase64);
+    num_bits += 6;
+    if (num_bits >= 8) {
+      num_bits -= 8;
+      emit(static_cast<uint8_t>(n >> num_bits));
+    }
+  }
+  return true;
+}
+
+}  // namespace
+
+SensorHistory::SensorHistory(unsigned decimals, size_t capacity)
+    : m_decimals(std::min(decimals, kMaxDecimals)),
+      m_scale(scale_for(decimals)),
+      // append() folds the next entry into the base when evicting, so the ring needs at least
+      // two entries.
+      m_entries(std::max<size_t>(capacity, 2)) {}
+
+int32_t SensorHistory::quantize(float value) const {
+  const double q = std::round(static_cast<double>(value) * m_scale);
+  if (q >= INT32_MAX) {
+    return INT32_MAX;
+  }
+  if (q <= INT32_MIN) {
+    return INT32_MIN;
+  }
+  return static_cast<int32_t>(q);
+}
+
+void SensorHistory::add(uint32_t secs, float value) {
+  // Satellites send NaN for failed reads, which can't be quantized.
+  if (!std::isfinite(value)) {
+    add_gap(secs);
+    return;
+  }
+  push(secs, quantize(value), false);
+}
+
+void SensorHistory::add_gap(uint32_t secs) { push(secs, 0, true); }
+
+void SensorHistory::clear() {
+  m_head = 0;
+  m_size = 0;
+  m_num_valid = 0;
+  m_base_secs = m_last_secs = 0;
+  m_base_q = m_last_q = 0;
+}
+
+void SensorHistory::push(uint32_t secs, int32_t q, bool is_gap) {
+  if (m_size > 0 && secs > m_last_secs) {
+    // dt_secs only covers about 18 hours, so longer silences are filled with gap entries.
+    const uint32_t num_fillers = (secs - m_last_secs - 1) / UINT16_MAX;
+    if (num_fillers >= m_entries.size()) {
+      // Every sample would be evicted by the fillers anyway.
+      clear();
+    }
+    for (uint32_t i = 0; m_size > 0 && i < num_fillers; i++) {
+      append({UINT16_MAX, kGap});
+      m_last_secs += UINT16_MAX;
+    }
+  }
+
+  Entry entry = {0, kGap};
+  if (m_size == 0) {
+    clear();
+    m_base_secs = m_last_secs = secs;
+  } else if (secs > m_last_secs) {
+    entry.dt_secs = static_cast<uint16_t>(secs - m_last_secs);
+    m_last_secs = secs;
+  }
+  if (!is_gap) {
+    if (m_num_valid == 0) {
+      // No earlier valid sample is in the ring, so anchor this one absolutely.  The entries
+      // before it are gaps, whose values are not used.
+      m_base_q = m_last_q = q;
+      entry.dv = 0;
+    } else {
+      // Deltas are taken against the reconstructed newest sample, so clamping only affects
+      // the sample being added.
+      const int64_t dv = static_cast<int64_t>(q) - m_last_q;
+      entry.dv = static_cast<int16_t>(std::clamp<int64_t>(dv, -INT16_MAX, INT16_MAX));
+      m_last_q += entry.dv;
+    }
+  }
+  append(entry);
+}
+
+void SensorHistory::append(const Entry& entry) {
+  if (m_size == m_entries.size()) {
+    // Drop the oldest sample, folding the next sample's deltas into the base.
+    if (m_entries[m_head].dv != kGap) {
+      m_num_valid -= 1;
+    }
+    m_head = (m_head + 1) % m_entries.size();
+    m_size -= 1;
+    const Entry& next = m_entries[m_head];
+    m_base_secs += next.dt_secs;
+    if (next.dv != kGap) {
+      m_base_q += next.dv;
+    }
+  }
+  m_entries[(m_head + m_size) % m_entries.size()] = entry;
+  m_size += 1;
+  if (entry.dv != kGap) {
+    m_num_valid += 1;
+  }
+}
+
+size_t SensorHistory::query(uint32_t start_secs, uint32_t end_secs, Bucket* buckets,
+                            size_t num_buckets) const {
+  if (!buckets || num_buckets == 0 || end_secs <= start_secs) {
+    return 0;
+  }
+  const uint64_t span = end_secs - start_secs;
+  std::vector<double> sums(num_buckets, 0.0);
+  for (size_t i = 0; i < num_buckets; i++) {
+    buckets[i] = Bucket();
+    buckets[i].start_secs = start_secs + static_cast<uint32_t>(span * i / num_buckets);
+  }
+  size_t num_samples = 0;
+  for_each([&](uint32_t secs, float value, bool is_valid) {
+    if (!is_valid || secs < start_secs || secs >= end_secs) {
+      return;
+    }
+    const size_t idx = static_cast<size_t>(uint64_t{secs - start_secs} * num_buckets / span);
+    Bucket& bucket = buckets[idx];
+    if (bucket.count == 0) {
+      bucket.min = bucket.max = value;
+    } else {
+      bucket.min = std::min(bucket.min, value);
+      bucket.max = std::max(bucket.max, value);
+    }
+    bucket.count += 1;
+    sums[idx] += value;
+    num_samples += 1;
+  });
+  for (size_t i = 0; i < num_buckets; i++) {
+    if (buckets[i].count > 0) {
+      buckets[i].avg = static_cast<float>(sums[i] / buckets[i].count);
+    }
+  }
+  return num_samples;
+}
+
+void SensorHistory::write_json(JsonObject obj) const {
+  obj["decimals"] = m_decimals;
+  obj["t"] = m_base_secs;
+  obj["v"] = m_base_q;
+  // Entries are written as base64 of their little-endian bytes, to keep the file and the
+  // JsonDocument small.
+  obj["d"] = base64_encode(m_size * kEntryBytes, [this](size_t i) -> uint8_t {
+    const Entry& entry = m_entries[(m_head + i / kEntryBytes) % m_entries.size()];
+    const uint16_t word = (i % kEntryBytes < 2) ? entry.dt_secs : static_cast<uint16_t>(entry.dv);
+    return (i % 2 == 0) ? (word & 0xff) : (word >> 8);
+  });
+}
+
+bool SensorHistory::read_json(JsonObjectConst obj) {
+  if (obj["decimals"].as<unsigned>() != m_decimals) {
+    return false;
+  }
+  const char* encoded = obj["d"] | "";
+  const size_t num_bytes = base64_decoded_size(encoded);
+  const size_t num_entries = num_bytes / kEntryBytes;
+  if (num_entries == 0 || num_bytes % kEntryBytes != 0) {
+    return false;
+  }
+  // If the saved history is longer than the ring, keep only its newest samples.
+  const size_t skip = num_entries > m_entries.size() ? num_entries - m_entries.size() : 0;
+  uint32_t secs = obj["t"];
+  int32_t q = obj["v"];
+  clear();
+  uint8_t bytes[kEntryBytes];
+  size_t num_decoded = 0;
+  const bool ok = base64_decode(encoded, [&](uint8_t byte) {
+    bytes[num_decoded % kEntryBytes] = byte;
+    num_decoded += 1;
+    if (num_decoded % kEntryBytes != 0) {
+      return;
+    }
+    const size_t i = num_decoded / kEntryBytes - 1;
+    Entry entry;
+    entry.dt_secs = static_cast<uint16_t>(bytes[0] | (bytes[1] << 8));
+    entry.dv = static_cast<int16_t>(static_cast<uint16_t>(bytes[2] | (bytes[3] << 8)));
+    if (i > 0) {
+      secs += entry.dt_secs;
+      if (entry.dv != kGap) {
+        q += entry.dv;
+      }
+    }
+    if (i < skip) {
+      return;
+    }
+    if (m_size == 0) {
+      m_base_secs = secs;
+      m_base_q = q;
+    }
+    m_entries[m_size] = entry;
+    m_size += 1;
+    if (entry.dv != kGap) {
+      m_num_valid += 1;
+    }
+  });
+  if (!ok || m_size == 0) {
+    clear();
+    return false;
+  }
+  m_last_secs = secs;
+  m_last_q = q;
+  return true;
+}
+
+}  // namespace og3::base_station
@@ -0,0 +1,79 @@
+// Copyright (c) 2026 Chris Lee and contributors.
+// Licensed under the MIT license. See LICENSE file in the project root for details.
+
+#include "og3/string-pool.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace og3::base_station {
+namespace {
+
+constexpr size_t kChunkHeader = sizeof(char*);
+
+}  // namespace
+
+StringArena::~StringArena() {
+  while (m_chunk) {
+    char* prev;
+    memcpy(&prev, m_chunk, sizeof(prev));
+    delete[] m_chunk;
+    m_chunk = prev;
+  }
+}
+
+char* StringArena::alloc(size_t len) {
+  const size_t size = len + 1;
+  if (!m_chunk || m_chunk_used + size > m_chunk_capacity) {
+    if (m_chunk && size > m_chunk_size) {
+      // Give a string longer than a chunk its own chunk, linked in behind the current one, so
+      // the space left in the current chunk is still used.
+      char* chunk = new char[kChunkHeader + size];
+      memcpy(chunk, m_chunk, kChunkHeader);
+      memcpy(m_chunk, &chunk, sizeof(chunk));
+      m_bytes_allocated += kChunkHeader + size;
+      return chunk + kChunkHeader;
+    }
+    const size_t capacity = std::max(m_chunk_size, size);
+    char* chunk = new char[kChunkHeader + capacity];
+    memcpy(chunk, &m_chunk, sizeof(m_chunk));
+    m_chunk = chunk;
+    m_chunk_used = 0;
+    m_chunk_capacity = capacity;
+    m_bytes_allocated += kChunkHeader + capacity;
+  }
+  char* str = m_chunk + kChunkHeader + m_chunk_used;
+  m_chunk_used += size;
+  return str;
+}
+
+const char* StringArena::add(const char* str, size_t len) {
+  char* out = alloc(len);
+  memcpy(out, str, len);
+  out[len] = '\0';
+  return out;
+}
+
+const char* StringArena::add(const char* str) {
+  if (!str) {
+    str = "";
+  }
+  return add(str, strlen(str));
+}
+
+const char* StringPool::intern(const char* str) {
+  static StringPool s_pool;
+  if (!str) {
+    str = "";
+  }
+  auto less = [](const char* a, const char* b) { return strcmp(a, b) < 0; };
+  auto iter = std::lower_bound(s_pool.m_strings.begin(), s_pool.m_strings.end(), str, less);
+  if (iter != s_pool.m_strings.end() && strcmp(*iter, str) == 0) {
+    return *iter;
+  }
+  const char* interned = s_pool.m_arena.add(str);
+  s_pool.m_strings.insert(iter, interned);
+  return interned;
+}
+
+}  // namespace og3::base_station
@@ -1,6 +1,9 @@
 // Copyright (c) 2025 Chris Lee and contibuters.
 // Licensed under the MIT license. See LICENSE file in the project root for details.
 
+#include <cmath>
+#include <cstring>
+
 #include "og3/base-station.h"
 #include "unity.h"
 
@@ -14,9 +17,271 @@ void tearDown() {
 
 void test_packet() {}
 
+void test_history_ring() {
+  og3::base_station::SensorHistory history(1, 8);
+  for (unsigned i = 0; i < 20; i++) {
+    history.add(100 + i * 10, 20.0f + 0.1f * i);
+  }
+  TEST_ASSERT_EQUAL(8, history.size());
+  TEST_ASSERT_EQUAL(220, history.oldest_secs());
+  TEST_ASSERT_EQUAL(290, history.newest_secs());
+  float expected = 21.2f;
+  history.for_each([&expected](uint32_t secs, float value, bool is_valid) {
+    TEST_ASSERT_TRUE(is_valid);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, expected, value);
+    expected += 0.1f;
+  });
+}
+
+void test_history_min_capacity() {
+  og3::base_station::SensorHistory history(0, 1);
+  TEST_ASSERT_EQUAL(2, history.capacity());
+  for (unsigned i = 0; i < 5; i++) {
+    history.add(i * 10, i);
+  }
+  TEST_ASSERT_EQUAL(2, history.size());
+  TEST_ASSERT_EQUAL(30, history.oldest_secs());
+  TEST_ASSERT_EQUAL(40, history.newest_secs());
+  float expected = 3.0f;
+  history.for_each([&expected](uint32_t secs, float value, bool is_valid) {
+    TEST_ASSERT_TRUE(is_valid);
+    TEST_ASSERT_EQUAL_FLOAT(expected, value);
+    expected += 1.0f;
+  });
+}
+
+void test_history_query() {
+  og3::base_station::SensorHistory history(0, 16);
+  history.add(0, 1);
+  history.add(10, 3);
+  history.add_gap(20);
+  history.add(30, 10);
+  history.add(40, 20);
+  og3::base_station::SensorHistory::Bucket buckets[2];
+  TEST_ASSERT_EQUAL(4, history.query(0, 50, buckets, 2));
+  TEST_ASSERT_EQUAL(0, buckets[0].start_secs);
+  TEST_ASSERT_EQUAL(2, buckets[0].count);
+  TEST_ASSERT_EQUAL_FLOAT(1.0f, buckets[0].min);
+  TEST_ASSERT_EQUAL_FLOAT(3.0f, buckets[0].max);
+  TEST_ASSERT_EQUAL_FLOAT(2.0f, buckets[0].avg);
+  TEST_ASSERT_EQUAL(25, buckets[1].start_secs);
+  TEST_ASSERT_EQUAL(2, buckets[1].count);
+  TEST_ASSERT_EQUAL_FLOAT(15.0f, buckets[1].avg);
+}
+
+void test_history_gaps() {
+  // A leading gap must not leave a stale anchor for the first valid sample.
+  og3::base_station::SensorHistory history(2, 8);
+  history.add_gap(0);
+  history.add(10, 1000.0f);
+  history.add(20, 1001.5f);
+  float expected[] = {1000.0f, 1001.5f};
+  unsigned i = 0;
+  history.for_each([&](uint32_t secs, float value, bool is_valid) {
+    if (is_valid) {
+      TEST_ASSERT_EQUAL_FLOAT(expected[i++], value);
+    }
+  });
+  TEST_ASSERT_EQUAL(2, i);
+
+  // Likewise after clear(), as done when a spilled history is rejected.
+  history.clear();
+  history.add_gap(40);
+  history.add(50, 1.0f);
+  og3::base_station::SensorHistory::Bucket bucket;
+  TEST_ASSERT_EQUAL(1, history.query(0, 100, &bucket, 1));
+  TEST_ASSERT_EQUAL_FLOAT(1.0f, bucket.avg);
+}
+
+void test_history_nan() {
+  og3::base_station::SensorHistory history(1, 8);
+  history.add(0, 20.0f);
+  history.add(10, NAN);
+  history.add(20, 21.0f);
+  float expected[] = {20.0f, 21.0f};
+  unsigned i = 0;
+  history.for_each([&](uint32_t secs, float value, bool is_valid) {
+    if (is_valid) {
+      TEST_ASSERT_EQUAL_FLOAT(expected[i++], value);
+    }
+  });
+  TEST_ASSERT_EQUAL(2, i);
+  TEST_ASSERT_EQUAL(3, history.size());
+}
+
+void test_history_long_silence() {
+  og3::base_station::SensorHistory history(0, 16);
+  history.add(0, 1);
+  history.add(100000, 2);
+  history.add(300000, 3);
+  TEST_ASSERT_EQUAL(300000, history.newest_secs());
+  uint32_t expected[] = {0, 100000, 300000};
+  unsigned i = 0;
+  history.for_each([&](uint32_t secs, float value, bool is_valid) {
+    if (is_valid) {
+      TEST_ASSERT_EQUAL(expected[i++], secs);
+    }
+  });
+  TEST_ASSERT_EQUAL(3, i);
+}
+
+void test_aggregator_window() {
+  og3::base_station::SensorAggregator::Config config;
+  config.window_secs = 60;
+  og3::base_station::SensorAggregator aggregator(config);
+  float out = 0.0f;
+  // The first reading is published immediately, then one mean per window.
+  TEST_ASSERT_TRUE(aggregator.add(0, 1.0f, &out));
+  TEST_ASSERT_EQUAL_FLOAT(1.0f, out);
+  TEST_ASSERT_FALSE(aggregator.add(20, 2.0f, &out));
+  TEST_ASSERT_FALSE(aggregator.add(40, 3.0f, &out));
+  TEST_ASSERT_TRUE(aggregator.add(60, 7.0f, &out));
+  TEST_ASSERT_EQUAL_FLOAT(4.0f, out);
+  TEST_ASSERT_EQUAL(3, aggregator.last_window().count);
+  TEST_ASSERT_EQUAL_FLOAT(2.0f, aggregator.last_window().min);
+  TEST_ASSERT_EQUAL_FLOAT(7.0f, aggregator.last_window().max);
+  // A straggling reading is published by flush() once its window has elapsed.
+  TEST_ASSERT_FALSE(aggregator.add(70, 5.0f, &out));
+  TEST_ASSERT_FALSE(aggregator.flush(100, &out));
+  TEST_ASSERT_TRUE(aggregator.flush(120, &out));
+  TEST_ASSERT_EQUAL_FLOAT(5.0f, out);
+}
+
+void test_aggregator_deadband() {
+  og3::base_station::SensorAggregator::Config config;
+  config.deadband = 1.0f;
+  config.max_quiet_secs = 100;
+  og3::base_station::SensorAggregator aggregator(config);
+  float out = 0.0f;
+  TEST_ASSERT_TRUE(aggregator.add(10, 10.0f, &out));
+  TEST_ASSERT_FALSE(aggregator.add(20, 10.5f, &out));
+  TEST_ASSERT_FALSE(aggregator.add(30, 10.9f, &out));
+  TEST_ASSERT_TRUE(aggregator.add(40, 11.2f, &out));
+  TEST_ASSERT_FALSE(aggregator.add(50, 11.3f, &out));
+  TEST_ASSERT_TRUE(aggregator.add(140, 11.3f, &out));
+}
+
+void test_string_pool() {
+  og3::base_station::StringArena arena(16);
+  const char* short_name = arena.add("moisture");
+  const char* long_name = arena.add("a name longer than one chunk");
+  TEST_ASSERT_EQUAL_STRING("moisture", short_name);
+  TEST_ASSERT_EQUAL_STRING("a name longer than one chunk", long_name);
+  // The long name gets its own chunk, and later names still fill the first one.
+  const char* rssi = arena.add("rssi");
+  TEST_ASSERT_EQUAL_PTR(short_name + strlen("moisture") + 1, rssi);
+  TEST_ASSERT_EQUAL(2 * sizeof(char*) + 16 + strlen("a name longer than one chunk") + 1,
+                    arena.bytes_allocated());
+  TEST_ASSERT_EQUAL_STRING("", arena.add(nullptr));
+
+  char units[] = "%";
+  const char* interned = og3::base_station::StringPool::intern(units);
+  TEST_ASSERT_EQUAL_PTR(interned, og3::base_station::StringPool::intern("%"));
+  TEST_ASSERT_NOT_EQUAL(interned, og3::base_station::StringPool::intern("V"));
+  TEST_ASSERT_EQUAL_STRING("%", interned);
+}
+
+void test_downlink_config() {
+  og3::base_station::Device::DownlinkConfig config;
+  og3_Downlink downlink og3_Downlink_init_zero;
+  TEST_ASSERT_FALSE(config.is_pending());
+  TEST_ASSERT_FALSE(config.make_downlink(5, downlink));
+
+  config.report_interval_secs = 600;
+  config.resend_desc = true;
+  config.changed();
+  TEST_ASSERT_TRUE(config.is_pending());
+  TEST_ASSERT_TRUE(config.make_downlink(5, downlink));
+  TEST_ASSERT_EQUAL(5, downlink.device_id);
+  TEST_ASSERT_EQUAL(config.id, downlink.config_id);
+  TEST_ASSERT_EQUAL(600, downlink.report_interval_secs);
+  TEST_ASSERT_EQUAL(0, downlink.batch_size);
+  TEST_ASSERT_TRUE(downlink.resend_desc);
+
+  // Packets sent before the satellite applied the downlink don't acknowledge it.
+  TEST_ASSERT_FALSE(config.got_ack(0));
+  TEST_ASSERT_TRUE(config.is_pending());
+  TEST_ASSERT_TRUE(config.got_ack(config.id));
+  TEST_ASSERT_FALSE(config.is_pending());
+  TEST_ASSERT_FALSE(config.resend_desc);
+
+  // A satellite which lost its configuration makes the downlink pending again.
+  TEST_ASSERT_FALSE(config.got_ack(0));
+  TEST_ASSERT_TRUE(config.is_pending());
+}
+
+void test_downlink_id_after_restart() {
+  // The base station forgot its config (id 0), but the satellite still reports id 7.
+  og3::base_station::Device::DownlinkConfig config;
+  TEST_ASSERT_FALSE(config.got_ack(7));
+  config.batch_size = 4;
+  config.changed();
+  // The new id must differ from the one the satellite already acknowledged.
+  TEST_ASSERT_EQUAL(8, config.id);
+  TEST_ASSERT_TRUE(config.is_pending());
+
+  config.id = UINT32_MAX;
+  config.changed();
+  TEST_ASSERT_EQUAL(1, config.id);
+}
+
+void test_dormant_device_json() {
+  const char* json = R"({"id":4660,"name":"garden","mfg":49459,"type":"Garden133","timeout":60000,
+    "hwMaj":1,"hwMin":2,"hwPat":0,"swMaj":0,"swMin":6,"swPat":3,
+    "downlink":{"id":3,"ack":2,"interval":600,"batch":4,"resend":true},
+    "sensors":[
+      {"id":1,"type":"float","name":"moisture","class":"moisture","units":"%",
+       "decimals":1,"state":1},
+      {"id":2,"type":"int","name":"count","class":"","units":"","state":0},
+      {"id":3,"type":"bogus","name":"skipped"}]})";
+  JsonDocument in;
+  TEST_ASSERT_FALSE(deserializeJson(in, json));
+  og3::base_station::DormantDevice device(in.as<JsonObjectConst>());
+  TEST_ASSERT_EQUAL(0x1234, device.id_num());
+  TEST_ASSERT_EQUAL_STRING("garden", device.name());
+  TEST_ASSERT_EQUAL(2, device.sensors().size());
+  TEST_ASSERT_TRUE(device.sensors()[0].is_float);
+  TEST_ASSERT_EQUAL(1, device.sensors()[0].decimals);
+  TEST_ASSERT_EQUAL_STRING("%", device.sensors()[0].units);
+  TEST_ASSERT_FALSE(device.sensors()[1].is_float);
+
+  JsonDocument out;
+  device.write_json(out.to<JsonObject>());
+  TEST_ASSERT_EQUAL(0x1234, out["id"].as<unsigned>());
+  TEST_ASSERT_EQUAL_STRING("Garden133", out["type"].as<const char*>());
+  TEST_ASSERT_EQUAL(60000, out["timeout"].as<unsigned>());
+  TEST_ASSERT_EQUAL(6, out["swMin"].as<unsigned>());
+  TEST_ASSERT_EQUAL(3, out["downlink"]["id"].as<unsigned>());
+  TEST_ASSERT_EQUAL(2, out["downlink"]["ack"].as<unsigned>());
+  TEST_ASSERT_EQUAL(600, out["downlink"]["interval"].as<unsigned>());
+  TEST_ASSERT_EQUAL(4, out["downlink"]["batch"].as<unsigned>());
+  TEST_ASSERT_TRUE(out["downlink"]["resend"].as<bool>());
+  JsonArrayConst sensors = out["sensors"].as<JsonArrayConst>();
+  TEST_ASSERT_EQUAL(2, sensors.size());
+  TEST_ASSERT_EQUAL_STRING("float", sensors[0]["type"].as<const char*>());
+  TEST_ASSERT_EQUAL_STRING("moisture", sensors[0]["name"].as<const char*>());
+  TEST_ASSERT_EQUAL(1, sensors[0]["decimals"].as<unsigned>());
+  TEST_ASSERT_EQUAL(1, sensors[0]["state"].as<int>());
+  TEST_ASSERT_EQUAL_STRING("int", sensors[1]["type"].as<const char*>());
+  TEST_ASSERT_EQUAL(2, sensors[1]["id"].as<unsigned>());
+  TEST_ASSERT_TRUE(sensors[1]["decimals"].isNull());
+}
+
 int runUnityTests() {
   UNITY_BEGIN();
   RUN_TEST(test_packet);
+  RUN_TEST(test_history_ring);
+  RUN_TEST(test_history_min_capacity);
+  RUN_TEST(test_history_query);
+  RUN_TEST(test_history_gaps);
+  RUN_TEST(test_history_long_silence);
+  RUN_TEST(test_history_nan);
+  RUN_TEST(test_aggregator_window);
+  RUN_TEST(test_aggregator_deadband);
+  RUN_TEST(test_string_pool);
+  RUN_TEST(test_downlink_config);
+  RUN_TEST(test_downlink_id_after_restart);
+  RUN_TEST(test_dormant_device_json);
   return UNITY_END();
 }
 
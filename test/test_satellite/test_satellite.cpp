@@ -14,9 +14,183 @@ void tearDown() {
 
 void test_packet() {}
 
+void test_oversampler() {
+  og3::satellite::Oversampler sampler(8);
+  const float samples[] = {1.0f, 1.1f, 0.9f, 1.0f, 50.0f, 1.05f, 0.95f, -20.0f};
+  for (float sample : samples) {
+    TEST_ASSERT_FALSE(sampler.is_done());
+    sampler.add(sample);
+  }
+  TEST_ASSERT_TRUE(sampler.is_done());
+  // The outliers (50 and -20) are discarded.
+  TEST_ASSERT_FLOAT_WITHIN(0.001f, 1.0f, sampler.value());
+
+  sampler.reset();
+  TEST_ASSERT_EQUAL(0, sampler.count());
+  sampler.add(3.0f);
+  TEST_ASSERT_EQUAL_FLOAT(3.0f, sampler.value());
+}
+
+namespace {
+
+// A reading which takes `num_polls` polls to complete, and records when it was started.
+class FakeReading : public og3::satellite::PacketReading {
+ public:
+  FakeReading(unsigned sensor_id, unsigned num_polls, unsigned* clock)
+      : PacketReading(sensor_id, og3_Sensor_Type_TYPE_UNSPECIFIED,
+                      og3_Sensor_StateClass_STATE_CLASS_UNSPECIFIED),
+        m_num_polls(num_polls),
+        m_clock(clock) {}
+
+  bool read() override { return true; }
+  void start_read() override {
+    m_started_at = (*m_clock)++;
+    m_polls_left = m_num_polls;
+  }
+  bool poll_read() override {
+    num_polls += 1;
+    if (m_polls_left > 0) {
+      m_polls_left -= 1;
+    }
+    return m_polls_left == 0;
+  }
+  bool write(og3_Packet& packet) override {
+    packet.i_reading[packet.i_reading_count].sensor_id = m_sensor_id;
+    packet.i_reading_count += 1;
+    return true;
+  }
+  bool write_desc(og3_Packet& packet) override { return true; }
+
+  unsigned started_at() const { return m_started_at; }
+  unsigned num_polls = 0;
+
+ private:
+  const unsigned m_num_polls;
+  unsigned m_polls_left = 0;
+  unsigned* m_clock;
+  unsigned m_started_at = 0;
+};
+
+// A sender without an App, so polls are driven by the test.
+class TestSender : public og3::satellite::PacketSender {
+ public:
+  TestSender(const og3_Device* device, Rtc* rtc) : PacketSender(device, nullptr, rtc) {}
+
+  FakeReading* add_reading(FakeReading* reading) {
+    m_readings.emplace_back(reading);
+    return reading;
+  }
+  using PacketSender::poll_readings;
+
+  unsigned clock = 0;
+  unsigned radio_started_at = 0;
+  unsigned num_packets = 0;
+  og3_Packet last_packet og3_Packet_init_zero;
+
+ protected:
+  void send_packet(og3_Packet& packet) override {
+    num_packets += 1;
+    last_packet = packet;
+  }
+  void start_radio() override { radio_started_at = clock++; }
+};
+
+}  // namespace
+
+void test_acquire_and_send() {
+  og3_Device device og3_Device_init_zero;
+  og3::satellite::PacketSender::Rtc rtc = {};
+  TestSender sender(&device, &rtc);
+  auto* fast = sender.add_reading(new FakeReading(1, 0, &sender.clock));
+  auto* slow = sender.add_reading(new FakeReading(2, 3, &sender.clock));
+  unsigned num_sent_calls = 0;
+
+  sender.acquire_and_send_readings([&num_sent_calls]() { num_sent_calls += 1; });
+  // The radio warms up while readings are acquired.
+  TEST_ASSERT_LESS_THAN(fast->started_at(), sender.radio_started_at);
+  TEST_ASSERT_LESS_THAN(slow->started_at(), sender.radio_started_at);
+  TEST_ASSERT_TRUE(sender.is_acquiring());
+  TEST_ASSERT_TRUE(sender.is_sending());
+  TEST_ASSERT_EQUAL(0, sender.num_packets);
+  // A second request while acquiring is ignored.
+  sender.acquire_and_send_readings();
+
+  sender.poll_readings();
+  sender.poll_readings();
+  TEST_ASSERT_FALSE(sender.is_acquiring());
+  TEST_ASSERT_EQUAL(1, sender.num_packets);
+  TEST_ASSERT_EQUAL(1, num_sent_calls);
+  TEST_ASSERT_EQUAL(2, sender.last_packet.i_reading_count);
+  // Readings which are done are not polled again.
+  TEST_ASSERT_EQUAL(1, fast->num_polls);
+  TEST_ASSERT_EQUAL(3, slow->num_polls);
+}
+
+void test_acquire_synchronous() {
+  og3_Device device og3_Device_init_zero;
+  og3::satellite::PacketSender::Rtc rtc = {};
+  TestSender sender(&device, &rtc);
+  sender.add_reading(new FakeReading(1, 0, &sender.clock));
+  // Readings which complete in start_read() are sent without waiting for a poll.
+  sender.acquire_and_send_readings();
+  TEST_ASSERT_FALSE(sender.is_acquiring());
+  TEST_ASSERT_EQUAL(1, sender.num_packets);
+}
+
+void test_apply_downlink() {
+  og3_Device device og3_Device_init_zero;
+  og3::satellite::PacketSender::Rtc rtc = {};
+  rtc.sensor_descriptions_sent = 2;
+  TestSender sender(&device, &rtc);
+  sender.set_board_id(5);
+  sender.add_reading(new FakeReading(1, 0, &sender.clock));
+
+  og3_Downlink downlink og3_Downlink_init_zero;
+  downlink.device_id = 6;
+  downlink.config_id = 3;
+  TEST_ASSERT_FALSE(sender.apply_downlink(downlink));
+  TEST_ASSERT_EQUAL(0, rtc.config_id);
+
+  downlink.device_id = 5;
+  downlink.report_interval_secs = 600;
+  downlink.batch_size = 4;
+  TEST_ASSERT_TRUE(sender.apply_downlink(downlink));
+  TEST_ASSERT_EQUAL(3, rtc.config_id);
+  TEST_ASSERT_EQUAL(600, sender.report_interval_secs(60));
+  TEST_ASSERT_EQUAL(4, sender.batch_size());
+  TEST_ASSERT_EQUAL(2, rtc.sensor_descriptions_sent);
+
+  // Fields which are 0 are left unchanged.
+  downlink.config_id = 4;
+  downlink.report_interval_secs = 0;
+  downlink.batch_size = 0;
+  downlink.resend_desc = true;
+  TEST_ASSERT_TRUE(sender.apply_downlink(downlink));
+  TEST_ASSERT_EQUAL(600, sender.report_interval_secs(60));
+  TEST_ASSERT_EQUAL(4, sender.batch_size());
+  TEST_ASSERT_EQUAL(0, rtc.sensor_descriptions_sent);
+
+  // The next packet acknowledges the configuration.
+  sender.acquire_and_send_readings();
+  TEST_ASSERT_EQUAL(1, sender.num_packets);
+  TEST_ASSERT_EQUAL(4, sender.last_packet.config_ack);
+  TEST_ASSERT_TRUE(sender.last_packet.has_device);
+}
+
+void test_report_timeout() {
+  TEST_ASSERT_EQUAL(3 * 600, og3::report_timeout_secs(600));
+  // Very long intervals saturate rather than overflow.
+  TEST_ASSERT_EQUAL(UINT32_MAX, og3::report_timeout_secs(UINT32_MAX / 2));
+}
+
 int runUnityTests() {
   UNITY_BEGIN();
   RUN_TEST(test_packet);
+  RUN_TEST(test_oversampler);
+  RUN_TEST(test_report_timeout);
+  RUN_TEST(test_acquire_and_send);
+  RUN_TEST(test_acquire_synchronous);
+  RUN_TEST(test_apply_downlink);
   return UNITY_END();
 }
 